@@ -0,0 +1,349 @@
+/*
+ * wgp-bench.c: User interface benchmark
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <sys/resource.h>
+#include <webkit/webkit.h>
+#include <grilo.h>
+#include "config.h"
+#include "wgp-player.h"
+#include "wgp-listing.h"
+#include "wgp-cache.h"
+#include "wgp-thumbnail.h"
+#include "wgp-fake-source.h"
+
+/*
+ * Browses a synthetic source in an offscreen web view through the same code
+ * paths used by the player: first the root of the source, then the first box
+ * as if it was clicked. Pages are requested by scrolling to the end of the
+ * listing until it is complete.
+ */
+
+/* The main loop is probed at this interval to measure its stalls */
+#define PROBE_INTERVAL 5
+
+static gint items = 100;
+static gint boxes = 10;
+static gint delay = 0;
+static gint metadata_cost = 0;
+static gint timeout = 300;
+
+static GOptionEntry entries[] = {
+        { "items", 0, 0, G_OPTION_ARG_INT, &items,
+          "Number of media items in every box", "N" },
+        { "boxes", 0, 0, G_OPTION_ARG_INT, &boxes,
+          "Number of boxes in the root of the source", "N" },
+        { "delay", 0, 0, G_OPTION_ARG_INT, &delay,
+          "Milliseconds between browse results", "MS" },
+        { "metadata-cost", 0, 0, G_OPTION_ARG_INT, &metadata_cost,
+          "Milliseconds taken by every metadata request", "MS" },
+        { "timeout", 0, 0, G_OPTION_ARG_INT, &timeout,
+          "Seconds before giving up", "SECONDS" },
+        { NULL }
+};
+
+typedef enum {
+        PHASE_ROOT,
+        PHASE_BOX,
+        PHASE_DONE
+} Phase;
+
+static const gchar *phase_names[PHASE_DONE + 1] = { "root", "box", "done" };
+
+static GrlMediaSource *source = NULL;
+static WebKitWebView *web_view = NULL;
+static WgpPlayer *player = NULL;
+
+static Phase phase = PHASE_ROOT;
+static gint64 phase_start = 0;
+static gint64 first_row = 0;
+static guint scroll_id = 0;
+
+static GArray *stalls = NULL;
+static gint64 next_probe = 0;
+static gboolean failed = FALSE;
+
+
+static gboolean
+probe_cb (gpointer user_data)
+{
+        gint64 now;
+        gint64 stall;
+
+        now = g_get_monotonic_time ();
+        stall = MAX (now - next_probe, 0);
+        g_array_append_val (stalls, stall);
+        next_probe = now + PROBE_INTERVAL * 1000;
+
+        if (first_row == 0 && phase != PHASE_DONE &&
+            wgp_listing_get_commits (wgp_player_get_listing (player)) > 0) {
+                first_row = now;
+        }
+
+        return TRUE;
+}
+
+
+static gint
+compare_stalls (gconstpointer a, gconstpointer b)
+{
+        gint64 stall_a = *(const gint64 *) a;
+        gint64 stall_b = *(const gint64 *) b;
+
+        return stall_a < stall_b ? -1 : stall_a > stall_b;
+}
+
+
+static gdouble
+get_percentile (guint percentile)
+{
+        guint index;
+
+        if (stalls->len == 0) {
+                return 0;
+        }
+
+        index = MIN (stalls->len * percentile / 100, stalls->len - 1);
+
+        return g_array_index (stalls, gint64, index) / 1000.0;
+}
+
+
+static void
+print_summary ()
+{
+        struct rusage usage;
+
+        getrusage (RUSAGE_SELF, &usage);
+        g_array_sort (stalls, compare_stalls);
+
+        g_print ("items=%d peak-rss=%ldKB stalls: p50=%.1fms p90=%.1fms "
+                 "p99=%.1fms max=%.1fms (%u probes)\n",
+                 items,
+                 usage.ru_maxrss,
+                 get_percentile (50),
+                 get_percentile (90),
+                 get_percentile (99),
+                 get_percentile (100),
+                 stalls->len);
+}
+
+
+static void
+start_phase (Phase next)
+{
+        phase = next;
+        phase_start = g_get_monotonic_time ();
+        first_row = 0;
+
+        switch (phase) {
+        case PHASE_ROOT:
+                wgp_player_open_source (player, source);
+                break;
+        case PHASE_BOX:
+                /* Same path as clicking on the first row */
+                wgp_player_activate (player, 0);
+                break;
+        case PHASE_DONE:
+                print_summary ();
+                gtk_main_quit ();
+                break;
+        }
+}
+
+
+/* Types a filter letter by letter, as the filter box does */
+static void
+bench_filter (WgpListing *listing)
+{
+        const gchar *text = "video 12";
+        gchar *prefix;
+        gint64 start;
+        gint64 elapsed;
+        gint64 slowest = 0;
+        guint i;
+
+        for (i = 1; i <= strlen (text); i++) {
+                prefix = g_strndup (text, i);
+                start = g_get_monotonic_time ();
+                wgp_listing_set_filter (listing, prefix);
+                elapsed = g_get_monotonic_time () - start;
+                slowest = MAX (slowest, elapsed);
+                g_free (prefix);
+        }
+
+        g_print ("items=%d phase=filter rows=%u slowest-keystroke=%.2fms\n",
+                 items,
+                 wgp_listing_get_length (listing),
+                 slowest / 1000.0);
+
+        wgp_listing_set_filter (listing, NULL);
+}
+
+
+static void
+finish_phase ()
+{
+        gint64 elapsed;
+        guint length;
+
+        elapsed = g_get_monotonic_time () - phase_start;
+        length = wgp_listing_get_length (wgp_player_get_listing (player));
+
+        g_print ("items=%d phase=%s rows=%u total=%.1fms first-row=%.1fms "
+                 "items/s=%.0f\n",
+                 items,
+                 phase_names[phase],
+                 length,
+                 elapsed / 1000.0,
+                 first_row ? (first_row - phase_start) / 1000.0 : -1,
+                 elapsed > 0 ? length * 1e6 / elapsed : 0);
+
+        if (phase == PHASE_ROOT) {
+                bench_filter (wgp_player_get_listing (player));
+        }
+
+        if (phase == PHASE_ROOT && boxes > 0) {
+                start_phase (PHASE_BOX);
+        } else {
+                start_phase (PHASE_DONE);
+        }
+}
+
+
+/* Scrolls to the end of the listing, so the next page is requested */
+static gboolean
+scroll_cb (gpointer user_data)
+{
+        WgpListing *listing;
+        WebKitDOMElement *sources;
+
+        scroll_id = 0;
+        listing = wgp_player_get_listing (player);
+
+        if (wgp_listing_is_complete (listing)) {
+                finish_phase ();
+                return FALSE;
+        }
+
+        sources = webkit_dom_document_get_element_by_id (
+                webkit_web_view_get_dom_document (web_view),
+                "sources");
+        webkit_dom_element_set_scroll_top (
+                sources,
+                wgp_listing_get_length (listing) * WGP_LISTING_ROW_HEIGHT);
+        wgp_listing_update (listing);
+
+        return FALSE;
+}
+
+
+static void
+browse_cb (GrlMedia *media, guint remaining, gpointer user_data)
+{
+        if (first_row == 0 &&
+            wgp_listing_get_commits (wgp_player_get_listing (player)) > 0) {
+                first_row = g_get_monotonic_time ();
+        }
+
+        if (remaining == 0 && scroll_id == 0) {
+                scroll_id = g_idle_add (scroll_cb, NULL);
+        }
+}
+
+
+static void
+ready_cb (gpointer user_data)
+{
+        GError *error = NULL;
+
+        source = wgp_fake_source_new (MAX (items, 0),
+                                      MAX (boxes, 0),
+                                      MAX (delay, 0),
+                                      MAX (metadata_cost, 0));
+        if (!grl_plugin_registry_register_source (grl_plugin_registry_get_default (),
+                                                  NULL,
+                                                  GRL_MEDIA_PLUGIN (source),
+                                                  &error)) {
+                g_printerr ("Could not register the fake source: %s\n",
+                            error->message);
+                g_error_free (error);
+                failed = TRUE;
+                gtk_main_quit ();
+                return;
+        }
+
+        next_probe = g_get_monotonic_time () + PROBE_INTERVAL * 1000;
+        g_timeout_add (PROBE_INTERVAL, probe_cb, NULL);
+
+        start_phase (PHASE_ROOT);
+}
+
+
+static gboolean
+timeout_cb (gpointer user_data)
+{
+        g_printerr ("Benchmark timed out in phase %s\n", phase_names[phase]);
+        failed = TRUE;
+        gtk_main_quit ();
+
+        return FALSE;
+}
+
+
+gint
+main (gint argc, gchar **argv)
+{
+        GtkWidget *window;
+        GOptionContext *context;
+        GError *error = NULL;
+
+        gtk_init (&argc, &argv);
+        grl_init (&argc, &argv);
+
+        context = g_option_context_new ("- Web Grilo Player benchmark");
+        g_option_context_add_main_entries (context, entries, NULL);
+        if (!g_option_context_parse (context, &argc, &argv, &error)) {
+                g_printerr ("%s\n", error->message);
+                return 1;
+        }
+        g_option_context_free (context);
+
+        /* Every page is browsed only once, the cache does not play a role */
+        wgp_cache_init (WGP_CACHE_DEFAULT_BUDGET, WGP_CACHE_DEFAULT_TTL);
+        wgp_thumbnail_init (WGP_THUMBNAIL_DEFAULT_WORKERS,
+                            WGP_THUMBNAIL_DEFAULT_CACHE_SIZE);
+
+        stalls = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+        window = gtk_offscreen_window_new ();
+        web_view = WEBKIT_WEB_VIEW (webkit_web_view_new ());
+        gtk_container_add (GTK_CONTAINER (window), GTK_WIDGET (web_view));
+        gtk_window_set_default_size (GTK_WINDOW (window), 800, 600);
+
+        player = wgp_player_new (web_view, FALSE, ready_cb, NULL);
+        wgp_player_set_browse_func (player, browse_cb, NULL);
+        gtk_widget_show_all (window);
+
+        g_timeout_add_seconds (MAX (timeout, 1), timeout_cb, NULL);
+
+        gtk_main ();
+
+        return failed ? 1 : 0;
+}
@@ -0,0 +1,224 @@
+/*
+ * wgp-cache.c: Browse results cache
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wgp-cache.h"
+
+/* Rough memory used by a GrlMedia, besides its strings */
+#define MEDIA_SIZE 512
+
+typedef struct {
+        gchar *key;
+        gchar *source_id;
+        GPtrArray *items;
+        gsize size;
+        gint64 timestamp;
+        GList link;
+} CacheEntry;
+
+/*
+ * Pages of browse results, in LRU order (most recently used first). Entries
+ * older than the TTL of their source are still returned, flagged as stale,
+ * so the caller can show them while revalidating.
+ */
+static GHashTable *entries = NULL;
+static GQueue lru = G_QUEUE_INIT;
+static GHashTable *source_ttls = NULL;
+
+static gsize budget = WGP_CACHE_DEFAULT_BUDGET;
+static guint default_ttl = WGP_CACHE_DEFAULT_TTL;
+static gsize size = 0;
+
+static guint hits = 0;
+static guint misses = 0;
+static guint evictions = 0;
+
+
+static gsize
+media_size (GrlMedia *media)
+{
+        return MEDIA_SIZE +
+                strlen (grl_media_get_id (media) ? grl_media_get_id (media) : "") +
+                strlen (grl_media_get_title (media) ? grl_media_get_title (media) : "") +
+                strlen (grl_media_get_url (media) ? grl_media_get_url (media) : "");
+}
+
+static void
+entry_free (CacheEntry *entry)
+{
+        g_queue_unlink (&lru, &entry->link);
+        size -= entry->size;
+
+        g_free (entry->key);
+        g_free (entry->source_id);
+        g_ptr_array_unref (entry->items);
+        g_slice_free (CacheEntry, entry);
+}
+
+static guint
+get_ttl (const gchar *source_id)
+{
+        gpointer ttl;
+
+        if (g_hash_table_lookup_extended (source_ttls, source_id, NULL, &ttl)) {
+                return GPOINTER_TO_UINT (ttl);
+        }
+
+        return default_ttl;
+}
+
+static void
+evict (void)
+{
+        CacheEntry *entry;
+
+        while (size > budget && lru.tail) {
+                entry = lru.tail->data;
+                g_debug ("Cache evicting: %s", entry->key);
+                g_hash_table_remove (entries, entry->key);
+                evictions++;
+        }
+}
+
+
+void
+wgp_cache_init (gsize cache_budget, guint cache_default_ttl)
+{
+        budget = cache_budget;
+        default_ttl = cache_default_ttl;
+
+        entries = g_hash_table_new_full (g_str_hash,
+                                         g_str_equal,
+                                         NULL,
+                                         (GDestroyNotify) entry_free);
+        source_ttls = g_hash_table_new_full (g_str_hash,
+                                             g_str_equal,
+                                             g_free,
+                                             NULL);
+}
+
+void
+wgp_cache_set_source_ttl (const gchar *source_id, guint ttl)
+{
+        g_hash_table_replace (source_ttls,
+                              g_strdup (source_id),
+                              GUINT_TO_POINTER (ttl));
+}
+
+gchar *
+wgp_cache_make_key (GrlMediaSource *source,
+                    GrlMedia *container,
+                    guint offset,
+                    const GList *keys)
+{
+        GString *key;
+        const GList *l;
+
+        key = g_string_new (
+                grl_metadata_source_get_id (GRL_METADATA_SOURCE (source)));
+        g_string_append_printf (key,
+                                "\x1f%s\x1f%u\x1f",
+                                container && grl_media_get_id (container) ?
+                                grl_media_get_id (container) : "",
+                                offset);
+        for (l = keys; l; l = l->next) {
+                g_string_append_printf (key, "%p,", l->data);
+        }
+
+        return g_string_free (key, FALSE);
+}
+
+GPtrArray *
+wgp_cache_lookup (const gchar *key, gboolean *stale)
+{
+        CacheEntry *entry;
+        gint64 age;
+
+        entry = g_hash_table_lookup (entries, key);
+        if (entry == NULL) {
+                misses++;
+                return NULL;
+        }
+
+        hits++;
+        g_queue_unlink (&lru, &entry->link);
+        g_queue_push_head_link (&lru, &entry->link);
+
+        age = g_get_monotonic_time () - entry->timestamp;
+        *stale = age >= (gint64) get_ttl (entry->source_id) * G_USEC_PER_SEC;
+
+        return g_ptr_array_ref (entry->items);
+}
+
+/* Whether @key has a fresh entry, without touching the LRU or the stats */
+gboolean
+wgp_cache_contains (const gchar *key)
+{
+        CacheEntry *entry;
+        gint64 age;
+
+        entry = g_hash_table_lookup (entries, key);
+        if (entry == NULL) {
+                return FALSE;
+        }
+
+        age = g_get_monotonic_time () - entry->timestamp;
+
+        return age < (gint64) get_ttl (entry->source_id) * G_USEC_PER_SEC;
+}
+
+void
+wgp_cache_insert (const gchar *key,
+                  const gchar *source_id,
+                  GPtrArray *items)
+{
+        CacheEntry *entry;
+        guint i;
+
+        g_hash_table_remove (entries, key);
+
+        entry = g_slice_new0 (CacheEntry);
+        entry->key = g_strdup (key);
+        entry->source_id = g_strdup (source_id);
+        entry->items = g_ptr_array_ref (items);
+        entry->timestamp = g_get_monotonic_time ();
+        entry->link.data = entry;
+
+        entry->size = sizeof (CacheEntry) + strlen (key);
+        for (i = 0; i < items->len; i++) {
+                entry->size += media_size (g_ptr_array_index (items, i));
+        }
+
+        g_hash_table_insert (entries, entry->key, entry);
+        g_queue_push_head_link (&lru, &entry->link);
+        size += entry->size;
+
+        evict ();
+}
+
+void
+wgp_cache_get_stats (guint *cache_hits,
+                     guint *cache_misses,
+                     guint *cache_evictions,
+                     gsize *cache_size)
+{
+        *cache_hits = hits;
+        *cache_misses = misses;
+        *cache_evictions = evictions;
+        *cache_size = size;
+}
@@ -0,0 +1,59 @@
+/*
+ * wgp-cache.h: Browse results cache
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_CACHE_H__
+#define __WGP_CACHE_H__
+
+#include <grilo.h>
+
+#define WGP_CACHE_DEFAULT_BUDGET (4 * 1024 * 1024)
+#define WGP_CACHE_DEFAULT_TTL 300
+
+
+void
+wgp_cache_init (gsize budget, guint default_ttl);
+
+void
+wgp_cache_set_source_ttl (const gchar *source_id, guint ttl);
+
+gchar *
+wgp_cache_make_key (GrlMediaSource *source,
+                    GrlMedia *container,
+                    guint offset,
+                    const GList *keys);
+
+GPtrArray *
+wgp_cache_lookup (const gchar *key, gboolean *stale);
+
+gboolean
+wgp_cache_contains (const gchar *key);
+
+void
+wgp_cache_insert (const gchar *key,
+                  const gchar *source_id,
+                  GPtrArray *items);
+
+void
+wgp_cache_get_stats (guint *hits,
+                     guint *misses,
+                     guint *evictions,
+                     gsize *size);
+
+
+#endif
@@ -0,0 +1,455 @@
+/*
+ * wgp-crawler.c: Headless crawler of sources
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+
+#include "wgp-crawler.h"
+#include "wgp-scheduler.h"
+
+/*
+ * Walks whole sources without any user interface, writing one JSON line per
+ * media found. Every source has its own stack of containers pending, so the
+ * walk is depth first and the pending containers stay few even on huge
+ * trees. Pages are browsed at background priority through the scheduler, that
+ * limits the operations running on each source and retries the failed ones;
+ * the crawler only bounds how many are handed to it at once.
+ *
+ * Containers already browsed are skipped, so sources with links back to
+ * their parents are walked once, and the walk stops at a maximum depth.
+ *
+ * Unless full resolution is asked for, only the keys the source gives while
+ * browsing are written, so the URL and the duration may be missing.
+ */
+
+typedef struct _CrawlSource CrawlSource;
+
+typedef struct {
+        CrawlSource *crawl_source;
+        GrlMedia *container;
+        guint depth;
+        guint offset;
+        guint received;
+        gboolean started;
+} Task;
+
+struct _CrawlSource {
+        WgpCrawler *crawler;
+        GrlMediaSource *source;
+        GQueue pending;
+        GHashTable *visited;
+};
+
+struct _WgpCrawler {
+        FILE *output;
+        guint jobs;
+        guint max_depth_allowed;
+        GrlMetadataResolutionFlags flags;
+        GList *sources;
+        GMainLoop *loop;
+        guint running;
+        guint wait_id;
+
+        guint64 items;
+        guint64 containers;
+        guint pages;
+        guint errors;
+        guint max_depth;
+        guint skipped;
+        gint64 start_time;
+};
+
+static const GList *
+get_keys (void)
+{
+        static GList *keys = NULL;
+
+        if (keys == NULL) {
+                keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                                  GRL_METADATA_KEY_URL,
+                                                  GRL_METADATA_KEY_DURATION,
+                                                  GRL_METADATA_KEY_CHILDCOUNT,
+                                                  GRL_METADATA_KEY_THUMBNAIL,
+                                                  NULL);
+        }
+
+        return keys;
+}
+
+static Task *
+task_new (CrawlSource *crawl_source, GrlMedia *container, guint depth)
+{
+        Task *task;
+
+        task = g_slice_new0 (Task);
+        task->crawl_source = crawl_source;
+        task->container = container ? g_object_ref (container) : NULL;
+        task->depth = depth;
+
+        return task;
+}
+
+static void
+task_free (Task *task)
+{
+        if (task->container) {
+                g_object_unref (task->container);
+        }
+        g_slice_free (Task, task);
+}
+
+
+static void
+write_string (FILE *output, const gchar *name, const gchar *value)
+{
+        const gchar *p;
+
+        if (value == NULL) {
+                return;
+        }
+
+        fprintf (output, ", \"%s\": \"", name);
+        for (p = value; *p; p++) {
+                if (*p == '"' || *p == '\\') {
+                        fputc ('\\', output);
+                        fputc (*p, output);
+                } else if ((guchar) *p < 0x20) {
+                        fprintf (output, "\\u%04x", (guint) *p);
+                } else {
+                        fputc (*p, output);
+                }
+        }
+        fputc ('"', output);
+}
+
+static const gchar *
+get_type (GrlMedia *media)
+{
+        if (GRL_IS_MEDIA_BOX (media)) {
+                return "box";
+        } else if (GRL_IS_MEDIA_AUDIO (media)) {
+                return "audio";
+        } else if (GRL_IS_MEDIA_VIDEO (media)) {
+                return "video";
+        } else if (GRL_IS_MEDIA_IMAGE (media)) {
+                return "image";
+        }
+
+        return "media";
+}
+
+static void
+write_media (WgpCrawler *crawler, Task *task, GrlMedia *media)
+{
+        FILE *output = crawler->output;
+        gint childcount;
+
+        fprintf (output, "{\"depth\": %u", task->depth);
+        write_string (output, "source",
+                      grl_metadata_source_get_id (
+                              GRL_METADATA_SOURCE (task->crawl_source->source)));
+        write_string (output, "parent",
+                      task->container ? grl_media_get_id (task->container) : NULL);
+        write_string (output, "id", grl_media_get_id (media));
+        write_string (output, "type", get_type (media));
+        write_string (output, "title", grl_media_get_title (media));
+        write_string (output, "url", grl_media_get_url (media));
+        write_string (output, "thumbnail", grl_media_get_thumbnail (media));
+
+        if (GRL_IS_MEDIA_BOX (media)) {
+                childcount = grl_media_box_get_childcount (GRL_MEDIA_BOX (media));
+                if (childcount != GRL_METADATA_KEY_CHILDCOUNT_UNKNOWN) {
+                        fprintf (output, ", \"childcount\": %d", childcount);
+                }
+        } else if (grl_media_get_duration (media) > 0) {
+                fprintf (output, ", \"duration\": %d", grl_media_get_duration (media));
+        }
+
+        fputs ("}\n", output);
+}
+
+
+static void dispatch (WgpCrawler *crawler);
+
+/* Children go first, so the walk is depth first */
+static void
+push_container (CrawlSource *crawl_source, Task *task, GrlMedia *media)
+{
+        WgpCrawler *crawler = crawl_source->crawler;
+        const gchar *id;
+
+        /* A NULL id would browse the root again */
+        id = grl_media_get_id (media);
+        if (id == NULL ||
+            g_hash_table_contains (crawl_source->visited, id) ||
+            task->depth + 1 > crawler->max_depth_allowed) {
+                crawler->skipped++;
+                return;
+        }
+
+        g_hash_table_add (crawl_source->visited, g_strdup (id));
+        g_queue_push_head (&crawl_source->pending,
+                           task_new (crawl_source, media, task->depth + 1));
+}
+
+static void
+browse_cb (GrlMediaSource *source,
+           guint browse_id,
+           GrlMedia *media,
+           guint remaining,
+           gpointer user_data,
+           const GError *error)
+{
+        Task *task = user_data;
+        CrawlSource *crawl_source = task->crawl_source;
+        WgpCrawler *crawler = crawl_source->crawler;
+
+        if (media) {
+                task->received++;
+                crawler->items++;
+                write_media (crawler, task, media);
+
+                if (GRL_IS_MEDIA_BOX (media)) {
+                        push_container (crawl_source, task, media);
+                }
+                g_object_unref (media);
+        }
+
+        if (remaining > 0) {
+                return;
+        }
+
+        crawler->running--;
+        crawler->pages++;
+
+        if (error && g_error_matches (error,
+                                      WGP_SCHEDULER_ERROR,
+                                      WGP_SCHEDULER_ERROR_DEGRADED)) {
+                /* Tried again once the source is back, after the rows written */
+                task->offset += task->received;
+                task->received = 0;
+                g_queue_push_tail (&crawl_source->pending, task);
+        } else if (error) {
+                crawler->errors++;
+                g_warning ("Could not browse %s in %s: %s",
+                           task->container ? grl_media_get_id (task->container) : "root",
+                           grl_metadata_source_get_id (GRL_METADATA_SOURCE (source)),
+                           error->message);
+                task_free (task);
+        } else if (task->received == WGP_CRAWLER_PAGE_SIZE) {
+                /* Next page of the same container, before its children */
+                task->offset += task->received;
+                task->received = 0;
+                g_queue_push_head (&crawl_source->pending, task);
+        } else {
+                task_free (task);
+        }
+
+        dispatch (crawler);
+}
+
+static gboolean
+wait_cb (gpointer user_data)
+{
+        WgpCrawler *crawler = user_data;
+
+        crawler->wait_id = 0;
+        dispatch (crawler);
+
+        return FALSE;
+}
+
+/* Hands pending containers to the scheduler, round robin over the sources */
+static void
+dispatch (WgpCrawler *crawler)
+{
+        CrawlSource *crawl_source;
+        gboolean started;
+        gboolean waiting;
+        Task *task;
+        GList *l;
+
+        do {
+                started = FALSE;
+                waiting = FALSE;
+
+                for (l = crawler->sources;
+                     l && crawler->running < crawler->jobs;
+                     l = l->next) {
+                        crawl_source = l->data;
+                        if (g_queue_is_empty (&crawl_source->pending)) {
+                                continue;
+                        }
+                        if (wgp_scheduler_is_degraded (crawl_source->source)) {
+                                waiting = TRUE;
+                                continue;
+                        }
+
+                        task = g_queue_pop_head (&crawl_source->pending);
+                        if (!task->started) {
+                                task->started = TRUE;
+                                crawler->containers++;
+                                crawler->max_depth = MAX (crawler->max_depth,
+                                                          task->depth);
+                        }
+
+                        crawler->running++;
+                        started = TRUE;
+                        wgp_scheduler_browse (WGP_SCHEDULER_BACKGROUND,
+                                              crawl_source->source,
+                                              task->container,
+                                              get_keys (),
+                                              task->offset,
+                                              WGP_CRAWLER_PAGE_SIZE,
+                                              crawler->flags,
+                                              browse_cb,
+                                              task);
+                }
+        } while (started && crawler->running < crawler->jobs);
+
+        if (waiting && crawler->wait_id == 0) {
+                crawler->wait_id = g_timeout_add (WGP_CRAWLER_DEGRADED_WAIT,
+                                                  wait_cb,
+                                                  crawler);
+        }
+
+        if (crawler->running == 0 && !waiting) {
+                g_main_loop_quit (crawler->loop);
+        }
+}
+
+
+/*
+ * Creates a crawler writing to @filename, or to the standard output when it
+ * is NULL, with at most @jobs containers browsed at once and none deeper
+ * than @max_depth. Pages are browsed with @flags.
+ */
+WgpCrawler *
+wgp_crawler_new (const gchar *filename,
+                 guint jobs,
+                 guint max_depth,
+                 GrlMetadataResolutionFlags flags,
+                 GError **error)
+{
+        WgpCrawler *crawler;
+        FILE *output = stdout;
+
+        if (filename) {
+                output = fopen (filename, "w");
+                if (output == NULL) {
+                        g_set_error (error,
+                                     G_FILE_ERROR,
+                                     g_file_error_from_errno (errno),
+                                     "Could not open crawl output '%s': %s",
+                                     filename,
+                                     g_strerror (errno));
+                        return NULL;
+                }
+        }
+
+        crawler = g_slice_new0 (WgpCrawler);
+        crawler->output = output;
+        crawler->jobs = MAX (jobs, 1);
+        crawler->max_depth_allowed = max_depth;
+        crawler->flags = flags;
+        crawler->loop = g_main_loop_new (NULL, FALSE);
+
+        return crawler;
+}
+
+void
+wgp_crawler_free (WgpCrawler *crawler)
+{
+        CrawlSource *crawl_source;
+        GList *l;
+
+        for (l = crawler->sources; l; l = l->next) {
+                crawl_source = l->data;
+                g_queue_foreach (&crawl_source->pending, (GFunc) task_free, NULL);
+                g_queue_clear (&crawl_source->pending);
+                g_hash_table_destroy (crawl_source->visited);
+                g_object_unref (crawl_source->source);
+                g_slice_free (CrawlSource, crawl_source);
+        }
+        g_list_free (crawler->sources);
+
+        if (crawler->output != stdout) {
+                fclose (crawler->output);
+        }
+        g_main_loop_unref (crawler->loop);
+        g_slice_free (WgpCrawler, crawler);
+}
+
+void
+wgp_crawler_add_source (WgpCrawler *crawler, GrlMediaSource *source)
+{
+        CrawlSource *crawl_source;
+
+        crawl_source = g_slice_new0 (CrawlSource);
+        crawl_source->crawler = crawler;
+        crawl_source->source = g_object_ref (source);
+        g_queue_init (&crawl_source->pending);
+        crawl_source->visited = g_hash_table_new_full (g_str_hash,
+                                                       g_str_equal,
+                                                       g_free,
+                                                       NULL);
+        g_queue_push_tail (&crawl_source->pending,
+                           task_new (crawl_source, NULL, 0));
+
+        crawler->sources = g_list_append (crawler->sources, crawl_source);
+}
+
+/* Walks all the sources added, returns the number of containers that failed */
+guint
+wgp_crawler_run (WgpCrawler *crawler)
+{
+        guint retried;
+        guint timed_out;
+        guint rejected;
+        gdouble seconds;
+
+        crawler->start_time = g_get_monotonic_time ();
+        dispatch (crawler);
+        if (crawler->running > 0 || crawler->wait_id) {
+                g_main_loop_run (crawler->loop);
+        }
+        fflush (crawler->output);
+
+        seconds = (g_get_monotonic_time () - crawler->start_time) /
+                (gdouble) G_USEC_PER_SEC;
+        wgp_scheduler_get_failures (&retried, &timed_out, &rejected);
+
+        g_message ("Crawled %" G_GUINT64_FORMAT " items in %" G_GUINT64_FORMAT
+                   " containers (%u pages) in %.1f s, %.0f items/s",
+                   crawler->items,
+                   crawler->containers,
+                   crawler->pages,
+                   seconds,
+                   seconds > 0 ? crawler->items / seconds : 0);
+        g_message ("Crawl depth %u, %u containers skipped, %u errors, "
+                   "%u retries, %u timeouts, %u rejected",
+                   crawler->max_depth,
+                   crawler->skipped,
+                   crawler->errors,
+                   retried,
+                   timed_out,
+                   rejected);
+
+        return crawler->errors;
+}
@@ -0,0 +1,61 @@
+/*
+ * wgp-crawler.h: Headless crawler of sources
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_CRAWLER_H__
+#define __WGP_CRAWLER_H__
+
+#include <grilo.h>
+
+/* Containers browsed at once, on all the sources */
+#define WGP_CRAWLER_DEFAULT_JOBS 32
+
+/* Items requested on each browse */
+#define WGP_CRAWLER_PAGE_SIZE 500
+
+/* Containers deeper than this are written but not browsed */
+#define WGP_CRAWLER_DEFAULT_MAX_DEPTH 64
+
+/* Milliseconds before trying again the sources that were degraded */
+#define WGP_CRAWLER_DEGRADED_WAIT 1000
+
+/* Milliseconds to wait for the sources registered asynchronously */
+#define WGP_CRAWLER_SOURCE_WAIT 10000
+
+
+typedef struct _WgpCrawler WgpCrawler;
+
+
+WgpCrawler *
+wgp_crawler_new (const gchar *filename,
+                 guint jobs,
+                 guint max_depth,
+                 GrlMetadataResolutionFlags flags,
+                 GError **error);
+
+void
+wgp_crawler_free (WgpCrawler *crawler);
+
+void
+wgp_crawler_add_source (WgpCrawler *crawler, GrlMediaSource *source);
+
+guint
+wgp_crawler_run (WgpCrawler *crawler);
+
+
+#endif
@@ -0,0 +1,270 @@
+/*
+ * wgp-fake-source.c: Synthetic media source for benchmarks
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wgp-fake-source.h"
+
+/*
+ * The root of the source has @boxes boxes followed by @items videos, and
+ * every box has @items videos. Browse results are sent one per main loop
+ * iteration, or one every @delay milliseconds, as a real plugin would do.
+ * Metadata requests take @metadata_cost milliseconds.
+ */
+
+typedef struct {
+        WgpFakeSource *source;
+        GrlMediaSourceBrowseSpec *bs;
+        gchar *prefix;
+        guint index;
+        guint end;
+        guint boxes;
+        guint timeout_id;
+} BrowseOperation;
+
+typedef struct {
+        GrlMediaSourceMetadataSpec *ms;
+} MetadataOperation;
+
+G_DEFINE_TYPE (WgpFakeSource, wgp_fake_source, GRL_TYPE_MEDIA_SOURCE);
+
+
+static GrlMedia *
+create_media (BrowseOperation *operation, guint index)
+{
+        GrlMedia *media;
+        gchar *id;
+        gchar *title;
+
+        if (index < operation->boxes) {
+                media = grl_media_box_new ();
+                id = g_strdup_printf ("box-%u", index);
+                title = g_strdup_printf ("Box %u", index);
+        } else {
+                index -= operation->boxes;
+                media = grl_media_video_new ();
+                id = g_strdup_printf ("%sitem-%u", operation->prefix, index);
+                title = g_strdup_printf ("Video %u", index);
+        }
+
+        grl_media_set_id (media, id);
+        grl_media_set_title (media, title);
+        grl_media_set_source (media, WGP_FAKE_SOURCE_ID);
+
+        g_free (id);
+        g_free (title);
+
+        return media;
+}
+
+static void
+browse_operation_free (BrowseOperation *operation)
+{
+        if (operation->timeout_id) {
+                g_source_remove (operation->timeout_id);
+        }
+        g_free (operation->prefix);
+        g_slice_free (BrowseOperation, operation);
+}
+
+static gboolean
+browse_step_cb (gpointer user_data)
+{
+        BrowseOperation *operation = user_data;
+        GrlMediaSourceBrowseSpec *bs = operation->bs;
+        GrlMedia *media = NULL;
+        guint remaining;
+
+        if (operation->index < operation->end) {
+                media = create_media (operation, operation->index++);
+        }
+        remaining = operation->end - operation->index;
+
+        bs->callback (bs->source, bs->browse_id, media, remaining, bs->user_data, NULL);
+
+        if (remaining == 0) {
+                operation->timeout_id = 0;
+                g_hash_table_remove (operation->source->operations,
+                                     GUINT_TO_POINTER (bs->browse_id));
+                return FALSE;
+        }
+
+        return TRUE;
+}
+
+static void
+fake_browse (GrlMediaSource *source, GrlMediaSourceBrowseSpec *bs)
+{
+        WgpFakeSource *fake = WGP_FAKE_SOURCE (source);
+        BrowseOperation *operation;
+        const gchar *container_id = NULL;
+        guint total;
+
+        if (bs->container) {
+                container_id = grl_media_get_id (bs->container);
+        }
+
+        operation = g_slice_new0 (BrowseOperation);
+        operation->source = fake;
+        operation->bs = bs;
+
+        if (container_id) {
+                operation->prefix = g_strdup_printf ("%s/", container_id);
+                operation->boxes = 0;
+        } else {
+                operation->prefix = g_strdup ("");
+                operation->boxes = fake->boxes;
+        }
+
+        total = operation->boxes + fake->items;
+        operation->index = MIN (bs->skip, total);
+        operation->end = MIN (bs->skip + bs->count, total);
+
+        if (fake->delay > 0) {
+                operation->timeout_id = g_timeout_add (fake->delay,
+                                                       browse_step_cb,
+                                                       operation);
+        } else {
+                operation->timeout_id = g_idle_add (browse_step_cb, operation);
+        }
+
+        g_hash_table_insert (fake->operations,
+                             GUINT_TO_POINTER (bs->browse_id),
+                             operation);
+}
+
+/* The last result is still sent, so the caller can release its data */
+static void
+fake_cancel (GrlMediaSource *source, guint operation_id)
+{
+        WgpFakeSource *fake = WGP_FAKE_SOURCE (source);
+        BrowseOperation *operation;
+
+        operation = g_hash_table_lookup (fake->operations,
+                                         GUINT_TO_POINTER (operation_id));
+        if (operation) {
+                operation->end = operation->index;
+        }
+}
+
+static gboolean
+metadata_cb (gpointer user_data)
+{
+        MetadataOperation *operation = user_data;
+        GrlMediaSourceMetadataSpec *ms = operation->ms;
+        gchar *url;
+
+        if (GRL_IS_MEDIA_BOX (ms->media)) {
+                grl_media_box_set_childcount (
+                        GRL_MEDIA_BOX (ms->media),
+                        WGP_FAKE_SOURCE (ms->source)->items);
+        } else {
+                url = g_strdup_printf ("file:///dev/null#%s",
+                                       grl_media_get_id (ms->media));
+                grl_media_set_url (ms->media, url);
+                grl_media_set_duration (ms->media, 60);
+                g_free (url);
+        }
+
+        ms->callback (ms->source, ms->media, ms->user_data, NULL);
+        g_slice_free (MetadataOperation, operation);
+
+        return FALSE;
+}
+
+static void
+fake_metadata (GrlMediaSource *source, GrlMediaSourceMetadataSpec *ms)
+{
+        MetadataOperation *operation;
+
+        operation = g_slice_new (MetadataOperation);
+        operation->ms = ms;
+
+        g_timeout_add (WGP_FAKE_SOURCE (source)->metadata_cost,
+                       metadata_cb,
+                       operation);
+}
+
+static const GList *
+fake_supported_keys (GrlMetadataSource *source)
+{
+        static GList *keys = NULL;
+
+        if (keys == NULL) {
+                keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                                  GRL_METADATA_KEY_TITLE,
+                                                  GRL_METADATA_KEY_URL,
+                                                  GRL_METADATA_KEY_DURATION,
+                                                  GRL_METADATA_KEY_CHILDCOUNT,
+                                                  NULL);
+        }
+
+        return keys;
+}
+
+static void
+wgp_fake_source_finalize (GObject *object)
+{
+        g_hash_table_destroy (WGP_FAKE_SOURCE (object)->operations);
+
+        G_OBJECT_CLASS (wgp_fake_source_parent_class)->finalize (object);
+}
+
+static void
+wgp_fake_source_class_init (WgpFakeSourceClass *klass)
+{
+        GObjectClass *object_class = G_OBJECT_CLASS (klass);
+        GrlMediaSourceClass *source_class = GRL_MEDIA_SOURCE_CLASS (klass);
+        GrlMetadataSourceClass *metadata_class = GRL_METADATA_SOURCE_CLASS (klass);
+
+        object_class->finalize = wgp_fake_source_finalize;
+        source_class->browse = fake_browse;
+        source_class->cancel = fake_cancel;
+        source_class->metadata = fake_metadata;
+        metadata_class->supported_keys = fake_supported_keys;
+}
+
+static void
+wgp_fake_source_init (WgpFakeSource *source)
+{
+        source->operations = g_hash_table_new_full (
+                g_direct_hash,
+                g_direct_equal,
+                NULL,
+                (GDestroyNotify) browse_operation_free);
+}
+
+GrlMediaSource *
+wgp_fake_source_new (guint items,
+                     guint boxes,
+                     guint delay,
+                     guint metadata_cost)
+{
+        WgpFakeSource *source;
+
+        source = g_object_new (WGP_TYPE_FAKE_SOURCE,
+                               "source-id", WGP_FAKE_SOURCE_ID,
+                               "source-name", "Fake source",
+                               "source-desc", "Synthetic source for benchmarks",
+                               NULL);
+        source->items = items;
+        source->boxes = boxes;
+        source->delay = delay;
+        source->metadata_cost = metadata_cost;
+
+        return GRL_MEDIA_SOURCE (source);
+}
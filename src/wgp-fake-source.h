@@ -0,0 +1,61 @@
+/*
+ * wgp-fake-source.h: Synthetic media source for benchmarks
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_FAKE_SOURCE_H__
+#define __WGP_FAKE_SOURCE_H__
+
+#include <grilo.h>
+
+#define WGP_FAKE_SOURCE_ID "wgp-fake"
+
+#define WGP_TYPE_FAKE_SOURCE (wgp_fake_source_get_type ())
+#define WGP_FAKE_SOURCE(obj)                                            \
+        (G_TYPE_CHECK_INSTANCE_CAST ((obj), WGP_TYPE_FAKE_SOURCE, WgpFakeSource))
+
+
+typedef struct _WgpFakeSource WgpFakeSource;
+typedef struct _WgpFakeSourceClass WgpFakeSourceClass;
+
+struct _WgpFakeSource {
+        GrlMediaSource parent;
+
+        guint items;
+        guint boxes;
+        guint delay;
+        guint metadata_cost;
+
+        GHashTable *operations;
+};
+
+struct _WgpFakeSourceClass {
+        GrlMediaSourceClass parent_class;
+};
+
+
+GType
+wgp_fake_source_get_type (void);
+
+GrlMediaSource *
+wgp_fake_source_new (guint items,
+                     guint boxes,
+                     guint delay,
+                     guint metadata_cost);
+
+
+#endif
@@ -0,0 +1,386 @@
+/*
+ * wgp-index.c: Persistent index of browsed containers
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include "wgp-index.h"
+#include "wgp-util.h"
+
+/*
+ * Every page of a container browsed is written to its own file, named after
+ * the SHA-1 of the source id, container id and offset, so a later run can
+ * show it before the source answers. Files are only mapped while a page is
+ * read, the index is never loaded in memory.
+ *
+ * Pages are serialized in the main loop, but written by a single worker
+ * thread with g_file_set_contents(), which renames a temporary file, so a
+ * crash never leaves a half written page. The same worker prunes them,
+ * oldest first, when the index grows over its size, after the writes queued
+ * before. Files with another version or byte order are ignored.
+ *
+ * Layout: a header, an array of fixed size items and the strings they point
+ * to, as offsets from the start of the strings.
+ */
+
+#define INDEX_MAGIC "WGPI"
+#define INDEX_VERSION 1
+#define INDEX_BYTE_ORDER 0x01020304
+#define NO_STRING G_MAXUINT32
+
+typedef enum {
+        ITEM_MEDIA,
+        ITEM_BOX,
+        ITEM_VIDEO,
+        ITEM_AUDIO,
+        ITEM_IMAGE
+} ItemType;
+
+typedef struct {
+        gchar magic[4];
+        guint32 version;
+        guint32 byte_order;
+        guint32 n_items;
+        guint32 source_id;
+        guint32 container_id;
+        guint32 offset;
+        guint32 strings_size;
+} IndexHeader;
+
+typedef struct {
+        guint32 type;
+        gint32 duration;
+        gint32 childcount;
+        guint32 id;
+        guint32 title;
+        guint32 url;
+        guint32 thumbnail;
+} IndexItem;
+
+/* Page waiting to be written by the worker */
+typedef struct {
+        gchar *path;
+        GString *data;
+} IndexWrite;
+
+static gchar *index_dir = NULL;
+static gsize max_size = WGP_INDEX_DEFAULT_SIZE;
+static GThreadPool *pool = NULL;
+
+/* Bytes queued since the last prune, only used from the main loop */
+static gsize written = 0;
+
+/* Pushed to the pool to prune the index */
+static IndexWrite prune_write;
+
+
+static void
+worker_func (gpointer data, gpointer user_data)
+{
+        IndexWrite *write = data;
+        GError *error = NULL;
+
+        if (write == &prune_write) {
+                /* Leave some room, so it does not run after every page */
+                wgp_util_prune_directory (index_dir, max_size / 4 * 3, NULL);
+                return;
+        }
+
+        if (!g_file_set_contents (write->path,
+                                  write->data->str,
+                                  write->data->len,
+                                  &error)) {
+                g_warning ("Could not write index file %s: %s",
+                           write->path, error->message);
+                g_error_free (error);
+        }
+
+        g_free (write->path);
+        g_string_free (write->data, TRUE);
+        g_slice_free (IndexWrite, write);
+}
+
+static gchar *
+get_path (const gchar *source_id, const gchar *container_id, guint offset)
+{
+        gchar *key;
+        gchar *checksum;
+        gchar *name;
+        gchar *path;
+
+        key = g_strdup_printf ("%s\x1f%s\x1f%u",
+                               source_id,
+                               container_id ? container_id : "",
+                               offset);
+        checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+        name = g_strconcat (checksum, ".idx", NULL);
+        path = g_build_filename (index_dir, name, NULL);
+
+        g_free (key);
+        g_free (checksum);
+        g_free (name);
+
+        return path;
+}
+
+static guint32
+add_string (GString *strings, const gchar *string)
+{
+        guint32 offset;
+
+        if (string == NULL) {
+                return NO_STRING;
+        }
+
+        offset = strings->len;
+        g_string_append_len (strings, string, strlen (string) + 1);
+
+        return offset;
+}
+
+/* Strings are checked to be inside the file and terminated */
+static const gchar *
+get_string (const gchar *strings, guint32 strings_size, guint32 offset)
+{
+        if (offset == NO_STRING || offset >= strings_size ||
+            memchr (strings + offset, '\0', strings_size - offset) == NULL) {
+                return NULL;
+        }
+
+        return strings + offset;
+}
+
+static GrlMedia *
+create_media (const IndexItem *item,
+              const gchar *strings,
+              guint32 strings_size,
+              const gchar *source_id)
+{
+        GrlMedia *media;
+
+        switch (item->type) {
+        case ITEM_BOX:
+                media = grl_media_box_new ();
+                grl_media_box_set_childcount (GRL_MEDIA_BOX (media),
+                                              item->childcount);
+                break;
+        case ITEM_VIDEO:
+                media = grl_media_video_new ();
+                break;
+        case ITEM_AUDIO:
+                media = grl_media_audio_new ();
+                break;
+        case ITEM_IMAGE:
+                media = grl_media_image_new ();
+                break;
+        default:
+                media = grl_media_new ();
+                break;
+        }
+
+        grl_media_set_source (media, source_id);
+        grl_media_set_id (media, get_string (strings, strings_size, item->id));
+        grl_media_set_title (media,
+                             get_string (strings, strings_size, item->title));
+        grl_media_set_url (media, get_string (strings, strings_size, item->url));
+        grl_media_set_thumbnail (media,
+                                 get_string (strings, strings_size, item->thumbnail));
+        if (item->duration > 0) {
+                grl_media_set_duration (media, item->duration);
+        }
+
+        return media;
+}
+
+
+void
+wgp_index_init (gsize size)
+{
+        index_dir = g_build_filename (g_get_user_cache_dir (),
+                                      "wgp",
+                                      "index",
+                                      NULL);
+        g_mkdir_with_parents (index_dir, 0700);
+        max_size = size;
+
+        /* A single thread, so pages and prunes are done in order */
+        pool = g_thread_pool_new (worker_func, NULL, 1, FALSE, NULL);
+        g_thread_pool_push (pool, &prune_write, NULL);
+}
+
+/* Waits for the pages still being written */
+void
+wgp_index_shutdown (void)
+{
+        if (pool == NULL) {
+                return;
+        }
+
+        g_thread_pool_free (pool, FALSE, TRUE);
+        pool = NULL;
+        g_free (index_dir);
+        index_dir = NULL;
+}
+
+/*
+ * Returns the items stored for the page of @container_id (NULL for the root)
+ * at @offset, or NULL if it is not in the index.
+ */
+GPtrArray *
+wgp_index_lookup (const gchar *source_id,
+                  const gchar *container_id,
+                  guint offset)
+{
+        GMappedFile *file;
+        const IndexHeader *header;
+        const IndexItem *items;
+        const gchar *strings;
+        GPtrArray *result = NULL;
+        gchar *path;
+        gsize length;
+        guint i;
+
+        if (index_dir == NULL) {
+                return NULL;
+        }
+
+        path = get_path (source_id, container_id, offset);
+        file = g_mapped_file_new (path, FALSE, NULL);
+        g_free (path);
+        if (file == NULL) {
+                return NULL;
+        }
+
+        length = g_mapped_file_get_length (file);
+        header = (const IndexHeader *) g_mapped_file_get_contents (file);
+
+        if (length < sizeof (IndexHeader) ||
+            memcmp (header->magic, INDEX_MAGIC, 4) != 0 ||
+            header->version != INDEX_VERSION ||
+            header->byte_order != INDEX_BYTE_ORDER ||
+            length != sizeof (IndexHeader) +
+                      (gsize) header->n_items * sizeof (IndexItem) +
+                      header->strings_size) {
+                goto out;
+        }
+
+        items = (const IndexItem *) (header + 1);
+        strings = (const gchar *) (items + header->n_items);
+
+        /* Different pages with the same checksum */
+        if (g_strcmp0 (get_string (strings, header->strings_size, header->source_id),
+                       source_id) != 0 ||
+            g_strcmp0 (get_string (strings, header->strings_size, header->container_id),
+                       container_id ? container_id : "") != 0 ||
+            header->offset != offset) {
+                goto out;
+        }
+
+        result = g_ptr_array_new_with_free_func (g_object_unref);
+        for (i = 0; i < header->n_items; i++) {
+                g_ptr_array_add (result,
+                                 create_media (&items[i],
+                                               strings,
+                                               header->strings_size,
+                                               source_id));
+        }
+
+ out:
+        g_mapped_file_unref (file);
+
+        return result;
+}
+
+void
+wgp_index_store (const gchar *source_id,
+                 const gchar *container_id,
+                 guint offset,
+                 GPtrArray *items)
+{
+        IndexHeader header;
+        IndexItem item;
+        GrlMedia *media;
+        GString *data;
+        GString *strings;
+        IndexWrite *write;
+        guint i;
+
+        if (index_dir == NULL) {
+                return;
+        }
+
+        strings = g_string_new (NULL);
+        data = g_string_sized_new (sizeof (IndexHeader) +
+                                   items->len * sizeof (IndexItem));
+
+        memset (&header, 0, sizeof (IndexHeader));
+        memcpy (header.magic, INDEX_MAGIC, 4);
+        header.version = INDEX_VERSION;
+        header.byte_order = INDEX_BYTE_ORDER;
+        header.n_items = items->len;
+        header.source_id = add_string (strings, source_id);
+        header.container_id = add_string (strings,
+                                          container_id ? container_id : "");
+        header.offset = offset;
+        g_string_append_len (data, (const gchar *) &header, sizeof (IndexHeader));
+
+        for (i = 0; i < items->len; i++) {
+                media = g_ptr_array_index (items, i);
+
+                if (GRL_IS_MEDIA_BOX (media)) {
+                        item.type = ITEM_BOX;
+                } else if (GRL_IS_MEDIA_VIDEO (media)) {
+                        item.type = ITEM_VIDEO;
+                } else if (GRL_IS_MEDIA_AUDIO (media)) {
+                        item.type = ITEM_AUDIO;
+                } else if (GRL_IS_MEDIA_IMAGE (media)) {
+                        item.type = ITEM_IMAGE;
+                } else {
+                        item.type = ITEM_MEDIA;
+                }
+
+                item.duration = grl_media_get_duration (media);
+                item.childcount = GRL_IS_MEDIA_BOX (media) ?
+                        grl_media_box_get_childcount (GRL_MEDIA_BOX (media)) : 0;
+                item.id = add_string (strings, grl_media_get_id (media));
+                item.title = add_string (strings, grl_media_get_title (media));
+                item.url = add_string (strings, grl_media_get_url (media));
+                item.thumbnail = add_string (strings,
+                                             grl_media_get_thumbnail (media));
+
+                g_string_append_len (data, (const gchar *) &item, sizeof (IndexItem));
+        }
+
+        /* The header goes first, so the size of the strings is patched */
+        ((IndexHeader *) data->str)->strings_size = strings->len;
+        g_string_append_len (data, strings->str, strings->len);
+
+        written += data->len;
+
+        write = g_slice_new (IndexWrite);
+        write->path = get_path (source_id, container_id, offset);
+        write->data = data;
+        g_thread_pool_push (pool, write, NULL);
+
+        if (written > max_size / 8) {
+                written = 0;
+                g_thread_pool_push (pool, &prune_write, NULL);
+        }
+
+        g_string_free (strings, TRUE);
+}
@@ -0,0 +1,46 @@
+/*
+ * wgp-index.h: Persistent index of browsed containers
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_INDEX_H__
+#define __WGP_INDEX_H__
+
+#include <grilo.h>
+
+#define WGP_INDEX_DEFAULT_SIZE (20 * 1024 * 1024)
+
+
+void
+wgp_index_init (gsize max_size);
+
+void
+wgp_index_shutdown (void);
+
+GPtrArray *
+wgp_index_lookup (const gchar *source_id,
+                  const gchar *container_id,
+                  guint offset);
+
+void
+wgp_index_store (const gchar *source_id,
+                 const gchar *container_id,
+                 guint offset,
+                 GPtrArray *items);
+
+
+#endif
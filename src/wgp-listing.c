@@ -0,0 +1,829 @@
+/*
+ * wgp-listing.c: Virtualized listing
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wgp-listing.h"
+#include "wgp-util.h"
+#include "wgp-trace.h"
+#include "wgp-watchdog.h"
+
+/*
+ * Only the rows in (and near) the visible area of the container exist in the
+ * DOM. Two spacers above and below them keep the scroll height as if every
+ * item was rendered.
+ *
+ * Rows are drawn from the fields copied to the model, which also gives the
+ * order they are shown in. The items are not owned by the listing, they have
+ * to be alive until it is cleared.
+ */
+struct _WgpListing {
+        WebKitDOMDocument *document;
+        WebKitDOMNode *container;
+        WebKitDOMElement *top_spacer;
+        WebKitDOMElement *bottom_spacer;
+
+        WgpModel *model;
+
+        /* Rendered rows are positions [first, first + rows.length) */
+        GQueue rows;
+        guint first;
+        guint top_rows;
+        guint bottom_rows;
+
+        /* Items appended but not committed to the DOM yet */
+        guint pending;
+        guint flush_id;
+        guint batch_size;
+        guint flush_interval;
+        guint commits;
+
+        /* Rendered rows are no longer in their positions */
+        gboolean reset;
+
+        gboolean complete;
+        gboolean fetching;
+        guint page_start;
+
+        /* The page from page_start on could not be fetched */
+        gboolean failed;
+
+        WgpListingFetchFunc fetch_func;
+        WgpListingActivateFunc activate_func;
+        gpointer user_data;
+
+        WgpListingRowFunc row_func;
+        gpointer row_data;
+
+        WgpListingRowFunc row_hidden_func;
+        gpointer row_hidden_data;
+};
+
+/* Rows taken out of a listing to be shown again later */
+struct _WgpListingState {
+        WgpModel *model;
+        gboolean complete;
+        glong scroll_top;
+};
+
+
+/* Single handler for the clicks on every row */
+static void
+click_cb (WebKitDOMEventTarget* target,
+          WebKitDOMEvent* event,
+          WgpListing *listing)
+{
+        gpointer object;
+        guint index;
+
+        wgp_watchdog_enter (G_STRFUNC);
+        if (wgp_util_get_event_index (event, listing->container, &index) &&
+            (object = wgp_listing_get_item (listing, index)) != NULL) {
+                listing->activate_func (listing, object, listing->user_data);
+        }
+        wgp_watchdog_leave ();
+}
+
+static gchar *
+get_row_text (WgpModel *model, guint row)
+{
+        const gchar *title;
+        gint childcount;
+        gint duration;
+
+        title = wgp_model_get_title (model, row);
+
+        switch (wgp_model_get_item_type (model, row)) {
+        case WGP_MODEL_TYPE_SOURCE:
+                return g_strdup_printf ("+ %s", title);
+        case WGP_MODEL_TYPE_BOX:
+                childcount = wgp_model_get_childcount (model, row);
+                if (childcount > 0) {
+                        return g_strdup_printf ("+ %s (%d)", title, childcount);
+                }
+                return g_strdup_printf ("+ %s", title);
+        default:
+                duration = wgp_model_get_duration (model, row);
+                if (duration > 0) {
+                        return g_strdup_printf ("- %s (%d:%02d)",
+                                                title,
+                                                duration / 60,
+                                                duration % 60);
+                }
+                return g_strdup_printf ("- %s", title);
+        }
+}
+
+static WebKitDOMNode *
+create_row (WgpListing *listing, guint index)
+{
+        WebKitDOMElement *paragraph;
+        gchar *text;
+        guint row;
+
+        paragraph = webkit_dom_document_create_element (listing->document,
+                                                        "p",
+                                                        NULL);
+        webkit_dom_element_set_attribute (paragraph,
+                                          "class",
+                                          "ui-widget-content",
+                                          NULL);
+
+        text = g_strdup_printf ("%u", index);
+        webkit_dom_element_set_attribute (paragraph, "data-index", text, NULL);
+        g_free (text);
+
+        row = wgp_model_get_row (listing->model, index);
+        text = get_row_text (listing->model, row);
+        webkit_dom_node_set_text_content (WEBKIT_DOM_NODE (paragraph),
+                                          text,
+                                          NULL);
+        g_free (text);
+
+        /* Only compared by the hidden func, the object may be gone by then */
+        g_object_set_data (G_OBJECT (paragraph),
+                           "wgp-object",
+                           wgp_model_get_object (listing->model, row));
+
+        if (listing->row_func) {
+                listing->row_func (listing,
+                                   wgp_model_get_object (listing->model, row),
+                                   paragraph,
+                                   listing->row_data);
+        }
+
+        return WEBKIT_DOM_NODE (paragraph);
+}
+
+static void
+remove_row (WgpListing *listing, WebKitDOMNode *row)
+{
+        if (listing->row_hidden_func) {
+                listing->row_hidden_func (listing,
+                                          g_object_get_data (G_OBJECT (row),
+                                                             "wgp-object"),
+                                          WEBKIT_DOM_ELEMENT (row),
+                                          listing->row_hidden_data);
+        }
+
+        webkit_dom_node_remove_child (listing->container, row, NULL);
+}
+
+static void
+set_spacer_height (WebKitDOMElement *spacer, guint *current, guint rows)
+{
+        gchar *style;
+
+        if (*current == rows) {
+                return;
+        }
+        *current = rows;
+
+        style = g_strdup_printf ("height: %upx;",
+                                 rows * WGP_LISTING_ROW_HEIGHT);
+        webkit_dom_element_set_attribute (spacer, "style", style, NULL);
+        g_free (style);
+}
+
+static void
+remove_rows (WgpListing *listing)
+{
+        WebKitDOMNode *row;
+
+        while ((row = g_queue_pop_head (&listing->rows)) != NULL) {
+                remove_row (listing, row);
+        }
+}
+
+static void
+cancel_flush (WgpListing *listing)
+{
+        if (listing->flush_id) {
+                g_source_remove (listing->flush_id);
+                listing->flush_id = 0;
+        }
+        listing->pending = 0;
+}
+
+static gboolean
+flush_cb (gpointer user_data)
+{
+        WgpListing *listing = user_data;
+
+        wgp_watchdog_enter (G_STRFUNC);
+        listing->flush_id = 0;
+        wgp_listing_update (listing);
+        wgp_watchdog_leave ();
+
+        return FALSE;
+}
+
+/* Whether the rows rendered reach the end of the ones loaded */
+static gboolean
+is_near_end (WgpListing *listing)
+{
+        WebKitDOMElement *container;
+        glong last;
+
+        container = WEBKIT_DOM_ELEMENT (listing->container);
+        last = (webkit_dom_element_get_scroll_top (container) +
+                webkit_dom_element_get_client_height (container)) /
+                WGP_LISTING_ROW_HEIGHT + 1;
+
+        return last + 2 * WGP_LISTING_OVERSCAN >= wgp_model_get_length (listing->model);
+}
+
+static void
+scroll_cb (WebKitDOMEventTarget* target,
+           WebKitDOMEvent* event,
+           WgpListing *listing)
+{
+        wgp_watchdog_enter (G_STRFUNC);
+        wgp_listing_update (listing);
+
+        /* Only the user scrolling down to it tries the failed page again */
+        if (listing->failed &&
+            wgp_model_get_filter (listing->model) == NULL &&
+            is_near_end (listing)) {
+                wgp_listing_retry (listing);
+        }
+        wgp_watchdog_leave ();
+}
+
+
+WgpListing *
+wgp_listing_new (WebKitDOMDocument *document,
+                 WebKitDOMNode *container,
+                 WgpListingFetchFunc fetch_func,
+                 WgpListingActivateFunc activate_func,
+                 gpointer user_data)
+{
+        WgpListing *listing;
+
+        listing = g_slice_new0 (WgpListing);
+        listing->document = document;
+        listing->container = container;
+        listing->model = wgp_model_new ();
+        g_queue_init (&listing->rows);
+        listing->complete = TRUE;
+        listing->batch_size = WGP_LISTING_DEFAULT_BATCH_SIZE;
+        listing->flush_interval = WGP_LISTING_DEFAULT_FLUSH_INTERVAL;
+        listing->fetch_func = fetch_func;
+        listing->activate_func = activate_func;
+        listing->user_data = user_data;
+
+        wgp_util_remove_all_children (container);
+
+        listing->top_spacer = webkit_dom_document_create_element (document,
+                                                                  "div",
+                                                                  NULL);
+        listing->bottom_spacer = webkit_dom_document_create_element (document,
+                                                                     "div",
+                                                                     NULL);
+        listing->top_rows = listing->bottom_rows = G_MAXUINT;
+        set_spacer_height (listing->top_spacer, &listing->top_rows, 0);
+        set_spacer_height (listing->bottom_spacer, &listing->bottom_rows, 0);
+        webkit_dom_node_append_child (container,
+                                      WEBKIT_DOM_NODE (listing->top_spacer),
+                                      NULL);
+        webkit_dom_node_append_child (container,
+                                      WEBKIT_DOM_NODE (listing->bottom_spacer),
+                                      NULL);
+
+        g_signal_connect (container,
+                          "scroll-event",
+                          G_CALLBACK (scroll_cb),
+                          listing);
+        g_signal_connect (container,
+                          "click-event",
+                          G_CALLBACK (click_cb),
+                          listing);
+
+        return listing;
+}
+
+void
+wgp_listing_free (WgpListing *listing)
+{
+        cancel_flush (listing);
+        remove_rows (listing);
+        wgp_model_free (listing->model);
+        g_slice_free (WgpListing, listing);
+}
+
+void
+wgp_listing_clear (WgpListing *listing)
+{
+        cancel_flush (listing);
+        remove_rows (listing);
+        wgp_model_clear (listing->model);
+
+        listing->first = 0;
+        listing->complete = TRUE;
+        listing->fetching = FALSE;
+        listing->failed = FALSE;
+        listing->commits = 0;
+
+        set_spacer_height (listing->top_spacer, &listing->top_rows, 0);
+        set_spacer_height (listing->bottom_spacer, &listing->bottom_rows, 0);
+        webkit_dom_element_set_scroll_top (
+                WEBKIT_DOM_ELEMENT (listing->container),
+                0);
+}
+
+void
+wgp_listing_start_paging (WgpListing *listing)
+{
+        listing->complete = FALSE;
+        wgp_listing_update (listing);
+}
+
+void
+wgp_listing_append (WgpListing *listing, gpointer object)
+{
+        wgp_model_append (listing->model, object);
+
+        if (++listing->pending >= listing->batch_size) {
+                wgp_listing_update (listing);
+        } else if (listing->flush_id == 0) {
+                listing->flush_id = g_timeout_add (listing->flush_interval,
+                                                   flush_cb,
+                                                   listing);
+        }
+}
+
+void
+wgp_listing_end_page (WgpListing *listing)
+{
+        if (wgp_model_get_n_rows (listing->model) - listing->page_start <
+            WGP_LISTING_PAGE_SIZE) {
+                listing->complete = TRUE;
+        }
+        listing->fetching = FALSE;
+
+        wgp_listing_update (listing);
+}
+
+/*
+ * Ends a page that could not be fetched. Unlike wgp_listing_end_page() the
+ * listing is not complete, no more pages are asked for until
+ * wgp_listing_retry() fetches this one again.
+ */
+void
+wgp_listing_fail_page (WgpListing *listing)
+{
+        listing->fetching = FALSE;
+        listing->failed = TRUE;
+
+        wgp_listing_update (listing);
+}
+
+/* Fetches again the page that failed, dropping the rows it got */
+void
+wgp_listing_retry (WgpListing *listing)
+{
+        if (!listing->failed) {
+                return;
+        }
+
+        listing->failed = FALSE;
+        if (listing->page_start < wgp_model_get_n_rows (listing->model)) {
+                cancel_flush (listing);
+                wgp_model_truncate (listing->model, listing->page_start);
+                listing->reset = TRUE;
+        }
+
+        listing->fetching = TRUE;
+        listing->fetch_func (listing,
+                             listing->page_start,
+                             WGP_LISTING_PAGE_SIZE,
+                             listing->user_data);
+
+        wgp_listing_update (listing);
+}
+
+gboolean
+wgp_listing_is_failed (WgpListing *listing)
+{
+        return listing->failed;
+}
+
+/*
+ * Drops the items from @length on, so the rest of the page starting at
+ * @page_start can be appended again in their place and finished with
+ * wgp_listing_end_page().
+ */
+void
+wgp_listing_truncate (WgpListing *listing, guint page_start, guint length)
+{
+        if (length < wgp_model_get_n_rows (listing->model)) {
+                cancel_flush (listing);
+                wgp_model_truncate (listing->model, length);
+                listing->reset = TRUE;
+        }
+
+        listing->complete = FALSE;
+        listing->fetching = TRUE;
+        listing->page_start = page_start;
+}
+
+void
+wgp_listing_update (WgpListing *listing)
+{
+        WebKitDOMElement *container;
+        WebKitDOMDocumentFragment *fragment = NULL;
+        WebKitDOMNode *row;
+        gboolean changed = FALSE;
+        glong scroll_top;
+        glong height;
+        guint first;
+        guint last;
+        guint i;
+        guint length;
+        gint64 start;
+
+        start = wgp_trace_now ();
+        cancel_flush (listing);
+
+        /* Sorted rows can land in the middle of the rendered ones */
+        if (wgp_model_sort_appended (listing->model) <
+            listing->first + listing->rows.length) {
+                listing->reset = TRUE;
+        }
+        length = wgp_model_get_length (listing->model);
+
+        container = WEBKIT_DOM_ELEMENT (listing->container);
+        scroll_top = webkit_dom_element_get_scroll_top (container);
+        height = webkit_dom_element_get_client_height (container);
+
+        first = scroll_top / WGP_LISTING_ROW_HEIGHT;
+        first = first > WGP_LISTING_OVERSCAN ? first - WGP_LISTING_OVERSCAN : 0;
+        last = (scroll_top + height) / WGP_LISTING_ROW_HEIGHT + 1;
+        last = MIN (last + WGP_LISTING_OVERSCAN, length);
+        first = MIN (first, last);
+
+        /* Nothing in common with the rendered rows, start from scratch */
+        if (listing->reset ||
+            g_queue_is_empty (&listing->rows) ||
+            first >= listing->first + listing->rows.length ||
+            last <= listing->first) {
+                changed |= !g_queue_is_empty (&listing->rows);
+                remove_rows (listing);
+                listing->first = first;
+                listing->reset = FALSE;
+        }
+
+        while (listing->first < first) {
+                row = g_queue_pop_head (&listing->rows);
+                remove_row (listing, row);
+                listing->first++;
+                changed = TRUE;
+        }
+
+        while (listing->first + listing->rows.length > last) {
+                row = g_queue_pop_tail (&listing->rows);
+                remove_row (listing, row);
+                changed = TRUE;
+        }
+
+        /* New rows are built in a fragment and inserted at once */
+        if (listing->first > first) {
+                fragment = webkit_dom_document_create_document_fragment (
+                        listing->document);
+                for (i = first; i < listing->first; i++) {
+                        row = create_row (listing, i);
+                        webkit_dom_node_append_child (WEBKIT_DOM_NODE (fragment),
+                                                      row,
+                                                      NULL);
+                        g_queue_push_nth (&listing->rows, row, i - first);
+                }
+                webkit_dom_node_insert_before (
+                        listing->container,
+                        WEBKIT_DOM_NODE (fragment),
+                        g_queue_peek_nth (&listing->rows, listing->first - first),
+                        NULL);
+                listing->first = first;
+                changed = TRUE;
+        }
+
+        if (listing->first + listing->rows.length < last) {
+                fragment = webkit_dom_document_create_document_fragment (
+                        listing->document);
+                for (i = listing->first + listing->rows.length; i < last; i++) {
+                        row = create_row (listing, i);
+                        webkit_dom_node_append_child (WEBKIT_DOM_NODE (fragment),
+                                                      row,
+                                                      NULL);
+                        g_queue_push_tail (&listing->rows, row);
+                }
+                webkit_dom_node_insert_before (
+                        listing->container,
+                        WEBKIT_DOM_NODE (fragment),
+                        WEBKIT_DOM_NODE (listing->bottom_spacer),
+                        NULL);
+                changed = TRUE;
+        }
+
+        if (listing->top_rows != listing->first ||
+            listing->bottom_rows != length - last) {
+                set_spacer_height (listing->top_spacer,
+                                   &listing->top_rows,
+                                   listing->first);
+                set_spacer_height (listing->bottom_spacer,
+                                   &listing->bottom_rows,
+                                   length - last);
+                changed = TRUE;
+        }
+
+        if (changed) {
+                listing->commits++;
+                wgp_trace_complete ("dom", "commit", start,
+                                    "\"rows\": %u, \"items\": %u",
+                                    listing->rows.length,
+                                    length);
+        }
+
+        /*
+         * Ask for the next page when the user gets close to the end. A filter
+         * only narrows the rows already loaded, or a filter hiding most of
+         * them would browse the whole container.
+         */
+        if (!listing->complete && !listing->fetching && !listing->failed &&
+            wgp_model_get_filter (listing->model) == NULL &&
+            last + WGP_LISTING_OVERSCAN >= length) {
+                listing->fetching = TRUE;
+                listing->page_start = wgp_model_get_n_rows (listing->model);
+                listing->fetch_func (listing,
+                                     listing->page_start,
+                                     WGP_LISTING_PAGE_SIZE,
+                                     listing->user_data);
+        }
+}
+
+/* Number of rows, only those matching the filter */
+guint
+wgp_listing_get_length (WgpListing *listing)
+{
+        return wgp_model_get_length (listing->model);
+}
+
+/* Item shown at @index */
+gpointer
+wgp_listing_get_item (WgpListing *listing, guint index)
+{
+        if (index >= wgp_model_get_length (listing->model)) {
+                return NULL;
+        }
+
+        return wgp_model_get_object (listing->model,
+                                     wgp_model_get_row (listing->model, index));
+}
+
+/* Whether the last page has been received */
+gboolean
+wgp_listing_is_complete (WgpListing *listing)
+{
+        return listing->complete;
+}
+
+void
+wgp_listing_set_batching (WgpListing *listing,
+                          guint batch_size,
+                          guint flush_interval)
+{
+        listing->batch_size = MAX (batch_size, 1);
+        listing->flush_interval = flush_interval;
+}
+
+guint
+wgp_listing_get_commits (WgpListing *listing)
+{
+        return listing->commits;
+}
+
+void
+wgp_listing_set_row_func (WgpListing *listing,
+                          WgpListingRowFunc row_func,
+                          gpointer user_data)
+{
+        listing->row_func = row_func;
+        listing->row_data = user_data;
+}
+
+/* @row_func is called with the rows taken out of the document */
+void
+wgp_listing_set_row_hidden_func (WgpListing *listing,
+                                 WgpListingRowFunc row_func,
+                                 gpointer user_data)
+{
+        listing->row_hidden_func = row_func;
+        listing->row_hidden_data = user_data;
+}
+
+/* Copies again the fields of @object and redraws it if it is rendered */
+void
+wgp_listing_refresh (WgpListing *listing, gpointer object)
+{
+        WebKitDOMElement *row_element;
+        guint position;
+        guint row;
+        gchar *text;
+
+        row_element = wgp_listing_get_row (listing, object);
+        position = wgp_model_update (listing->model, object);
+
+        /* Sorted by a field that changed, it may have moved */
+        if (row_element == NULL ||
+            wgp_listing_get_row (listing, object) != row_element) {
+                if (row_element ||
+                    position < listing->first + listing->rows.length) {
+                        listing->reset = TRUE;
+                        wgp_listing_update (listing);
+                }
+                return;
+        }
+
+        if (wgp_model_lookup (listing->model, object, &row)) {
+                text = get_row_text (listing->model, row);
+                webkit_dom_node_set_text_content (WEBKIT_DOM_NODE (row_element),
+                                                  text,
+                                                  NULL);
+                g_free (text);
+        }
+}
+
+/* Returns the row of @object, or NULL if it is not rendered */
+WebKitDOMElement *
+wgp_listing_get_row (WgpListing *listing, gpointer object)
+{
+        GList *l;
+        guint index;
+
+        for (l = listing->rows.head, index = listing->first;
+             l;
+             l = l->next, index++) {
+                if (wgp_listing_get_item (listing, index) == object) {
+                        return WEBKIT_DOM_ELEMENT (l->data);
+                }
+        }
+
+        return NULL;
+}
+
+static void
+reset_rows (WgpListing *listing)
+{
+        cancel_flush (listing);
+        listing->reset = TRUE;
+        webkit_dom_element_set_scroll_top (
+                WEBKIT_DOM_ELEMENT (listing->container),
+                0);
+        wgp_listing_update (listing);
+}
+
+/* Sorts the rows locally, no new browse is needed */
+void
+wgp_listing_set_sort (WgpListing *listing,
+                      WgpModelSort sort,
+                      gboolean descending)
+{
+        gint64 start;
+
+        start = wgp_trace_now ();
+        wgp_model_set_sort (listing->model, sort, descending);
+        wgp_trace_complete ("model", "sort", start,
+                            "\"rows\": %u", wgp_model_get_length (listing->model));
+
+        reset_rows (listing);
+}
+
+/* Only shows the rows with @text in their title */
+void
+wgp_listing_set_filter (WgpListing *listing, const gchar *text)
+{
+        gint64 start;
+
+        start = wgp_trace_now ();
+        wgp_model_set_filter (listing->model, text);
+        wgp_trace_complete ("model", "filter", start,
+                            "\"rows\": %u", wgp_model_get_length (listing->model));
+
+        reset_rows (listing);
+}
+
+/* Number of items appended, whatever the filter */
+guint
+wgp_listing_get_n_appended (WgpListing *listing)
+{
+        return wgp_model_get_n_rows (listing->model);
+}
+
+/* Item appended in @nth place, whatever the sort and filter */
+gpointer
+wgp_listing_get_appended (WgpListing *listing, guint nth)
+{
+        return wgp_model_get_object (listing->model, nth);
+}
+
+/* Position after the last row in the DOM */
+guint
+wgp_listing_get_rendered_end (WgpListing *listing)
+{
+        return listing->first + listing->rows.length;
+}
+
+glong
+wgp_listing_get_scroll_top (WgpListing *listing)
+{
+        return webkit_dom_element_get_scroll_top (
+                WEBKIT_DOM_ELEMENT (listing->container));
+}
+
+void
+wgp_listing_set_scroll_top (WgpListing *listing, glong scroll_top)
+{
+        webkit_dom_element_set_scroll_top (
+                WEBKIT_DOM_ELEMENT (listing->container),
+                scroll_top);
+        wgp_listing_update (listing);
+}
+
+/*
+ * Takes the rows out of @listing, which is left empty, keeping their sort,
+ * filter and scroll position. Their items have to be alive until the state
+ * is restored or freed.
+ */
+WgpListingState *
+wgp_listing_save (WgpListing *listing)
+{
+        WgpListingState *state;
+        WgpModelSort sort;
+        gboolean descending;
+
+        state = g_slice_new (WgpListingState);
+        state->model = listing->model;
+        state->complete = listing->complete;
+        state->scroll_top = wgp_listing_get_scroll_top (listing);
+
+        listing->model = wgp_model_new ();
+        sort = wgp_model_get_sort (state->model, &descending);
+        wgp_model_set_sort (listing->model, sort, descending);
+        wgp_model_set_filter (listing->model,
+                              wgp_model_get_filter (state->model));
+        wgp_listing_clear (listing);
+
+        return state;
+}
+
+/*
+ * Shows again the rows saved in @state, which is freed, as they were left.
+ * Sort and filter changed meanwhile are applied to them. Paging goes on if
+ * the last page had not been received.
+ */
+void
+wgp_listing_restore (WgpListing *listing, WgpListingState *state)
+{
+        WgpModelSort sort;
+        gboolean descending;
+
+        wgp_listing_clear (listing);
+
+        sort = wgp_model_get_sort (listing->model, &descending);
+        wgp_model_set_sort (state->model, sort, descending);
+        wgp_model_set_filter (state->model,
+                              wgp_model_get_filter (listing->model));
+
+        wgp_model_free (listing->model);
+        listing->model = state->model;
+        listing->complete = state->complete;
+        listing->failed = FALSE;
+        listing->reset = TRUE;
+
+        /* The container has to be tall enough before scrolling it */
+        set_spacer_height (listing->bottom_spacer,
+                           &listing->bottom_rows,
+                           wgp_model_get_length (listing->model));
+        wgp_listing_set_scroll_top (listing, state->scroll_top);
+        g_slice_free (WgpListingState, state);
+}
+
+void
+wgp_listing_state_free (WgpListingState *state)
+{
+        wgp_model_free (state->model);
+        g_slice_free (WgpListingState, state);
+}
@@ -0,0 +1,161 @@
+/*
+ * wgp-listing.h: Virtualized listing
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_LISTING_H__
+#define __WGP_LISTING_H__
+
+#include <webkit/webkit.h>
+#include "wgp-model.h"
+
+/* Height in pixels of every row, it has to match the CSS for "#sources p" */
+#define WGP_LISTING_ROW_HEIGHT 32
+
+/* Rows rendered above and below the visible area */
+#define WGP_LISTING_OVERSCAN 10
+
+/* Number of items requested on each page */
+#define WGP_LISTING_PAGE_SIZE 100
+
+/* Appended items are committed to the DOM in batches */
+#define WGP_LISTING_DEFAULT_BATCH_SIZE 50
+#define WGP_LISTING_DEFAULT_FLUSH_INTERVAL 16
+
+
+typedef struct _WgpListing WgpListing;
+typedef struct _WgpListingState WgpListingState;
+
+typedef void (*WgpListingFetchFunc) (WgpListing *listing,
+                                     guint offset,
+                                     guint count,
+                                     gpointer user_data);
+
+typedef void (*WgpListingActivateFunc) (WgpListing *listing,
+                                        gpointer object,
+                                        gpointer user_data);
+
+typedef void (*WgpListingRowFunc) (WgpListing *listing,
+                                   gpointer object,
+                                   WebKitDOMElement *row,
+                                   gpointer user_data);
+
+
+WgpListing *
+wgp_listing_new (WebKitDOMDocument *document,
+                 WebKitDOMNode *container,
+                 WgpListingFetchFunc fetch_func,
+                 WgpListingActivateFunc activate_func,
+                 gpointer user_data);
+
+void
+wgp_listing_free (WgpListing *listing);
+
+void
+wgp_listing_clear (WgpListing *listing);
+
+void
+wgp_listing_start_paging (WgpListing *listing);
+
+void
+wgp_listing_append (WgpListing *listing, gpointer object);
+
+void
+wgp_listing_end_page (WgpListing *listing);
+
+void
+wgp_listing_fail_page (WgpListing *listing);
+
+void
+wgp_listing_retry (WgpListing *listing);
+
+gboolean
+wgp_listing_is_failed (WgpListing *listing);
+
+void
+wgp_listing_truncate (WgpListing *listing, guint page_start, guint length);
+
+void
+wgp_listing_update (WgpListing *listing);
+
+void
+wgp_listing_set_batching (WgpListing *listing,
+                          guint batch_size,
+                          guint flush_interval);
+
+guint
+wgp_listing_get_commits (WgpListing *listing);
+
+void
+wgp_listing_set_row_func (WgpListing *listing,
+                          WgpListingRowFunc row_func,
+                          gpointer user_data);
+
+void
+wgp_listing_set_row_hidden_func (WgpListing *listing,
+                                 WgpListingRowFunc row_func,
+                                 gpointer user_data);
+
+void
+wgp_listing_refresh (WgpListing *listing, gpointer object);
+
+WebKitDOMElement *
+wgp_listing_get_row (WgpListing *listing, gpointer object);
+
+guint
+wgp_listing_get_length (WgpListing *listing);
+
+void
+wgp_listing_set_sort (WgpListing *listing,
+                      WgpModelSort sort,
+                      gboolean descending);
+
+void
+wgp_listing_set_filter (WgpListing *listing, const gchar *text);
+
+gpointer
+wgp_listing_get_item (WgpListing *listing, guint index);
+
+gboolean
+wgp_listing_is_complete (WgpListing *listing);
+
+guint
+wgp_listing_get_n_appended (WgpListing *listing);
+
+gpointer
+wgp_listing_get_appended (WgpListing *listing, guint nth);
+
+guint
+wgp_listing_get_rendered_end (WgpListing *listing);
+
+glong
+wgp_listing_get_scroll_top (WgpListing *listing);
+
+void
+wgp_listing_set_scroll_top (WgpListing *listing, glong scroll_top);
+
+WgpListingState *
+wgp_listing_save (WgpListing *listing);
+
+void
+wgp_listing_restore (WgpListing *listing, WgpListingState *state);
+
+void
+wgp_listing_state_free (WgpListingState *state);
+
+
+#endif
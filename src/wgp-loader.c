@@ -0,0 +1,213 @@
+/*
+ * wgp-loader.c: Plugins loading
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gmodule.h>
+#include "config.h"
+#include "wgp-loader.h"
+#include "wgp-watchdog.h"
+
+/*
+ * Plugins are loaded one per main loop iteration, so the window keeps
+ * painting and the sources show up as they are registered. The sources found
+ * are saved to a small file, to show them on next start before any plugin is
+ * loaded.
+ */
+
+typedef struct {
+        GrlPluginRegistry *registry;
+        GQueue paths;
+        WgpLoaderDoneFunc done_func;
+        gpointer user_data;
+} Loader;
+
+
+static gchar *
+get_sources_file (void)
+{
+        return g_build_filename (g_get_user_cache_dir (), "wgp", "sources", NULL);
+}
+
+static void
+add_plugins_dir (Loader *loader, const gchar *path)
+{
+        GDir *dir;
+        const gchar *name;
+
+        dir = g_dir_open (path, 0, NULL);
+        if (dir == NULL) {
+                return;
+        }
+
+        while ((name = g_dir_read_name (dir)) != NULL) {
+                if (g_str_has_suffix (name, "." G_MODULE_SUFFIX)) {
+                        g_queue_push_tail (&loader->paths,
+                                           g_build_filename (path, name, NULL));
+                }
+        }
+        g_dir_close (dir);
+}
+
+static gboolean
+load_next_cb (gpointer user_data)
+{
+        Loader *loader = user_data;
+        gchar *path;
+
+        path = g_queue_pop_head (&loader->paths);
+        if (path) {
+                g_debug ("Loading plugin: %s", path);
+                wgp_watchdog_enter (G_STRFUNC);
+                if (!grl_plugin_registry_load (loader->registry, path)) {
+                        g_warning ("Failed to load plugin: %s", path);
+                }
+                wgp_watchdog_leave ();
+                g_free (path);
+
+                return TRUE;
+        }
+
+        wgp_watchdog_enter (G_STRFUNC);
+        loader->done_func (loader->user_data);
+        wgp_watchdog_leave ();
+        g_slice_free (Loader, loader);
+
+        return FALSE;
+}
+
+static gboolean
+load_all_cb (gpointer user_data)
+{
+        Loader *loader = user_data;
+
+        wgp_watchdog_enter (G_STRFUNC);
+        if (!grl_plugin_registry_load_all (loader->registry)) {
+                g_warning ("Failed to load plugins.");
+        }
+
+        loader->done_func (loader->user_data);
+        wgp_watchdog_leave ();
+        g_slice_free (Loader, loader);
+
+        return FALSE;
+}
+
+
+void
+wgp_loader_load_async (GrlPluginRegistry *registry,
+                       WgpLoaderDoneFunc done_func,
+                       gpointer user_data)
+{
+        Loader *loader;
+        const gchar *env;
+        gchar **dirs;
+        guint i;
+
+        loader = g_slice_new0 (Loader);
+        loader->registry = registry;
+        loader->done_func = done_func;
+        loader->user_data = user_data;
+        g_queue_init (&loader->paths);
+
+        env = g_getenv ("GRL_PLUGIN_PATH");
+        if (env) {
+                dirs = g_strsplit (env, G_SEARCHPATH_SEPARATOR_S, 0);
+                for (i = 0; dirs[i]; i++) {
+                        add_plugins_dir (loader, dirs[i]);
+                }
+                g_strfreev (dirs);
+        }
+        add_plugins_dir (loader, GRL_PLUGINS_DIR);
+
+        /* Fall back to Grilo if the plugins could not be found */
+        if (g_queue_is_empty (&loader->paths)) {
+                g_idle_add_full (G_PRIORITY_LOW, load_all_cb, loader, NULL);
+        } else {
+                g_idle_add_full (G_PRIORITY_LOW, load_next_cb, loader, NULL);
+        }
+}
+
+void
+wgp_loader_foreach_cached_source (WgpLoaderSourceFunc func,
+                                  gpointer user_data)
+{
+        GKeyFile *key_file;
+        gchar *path;
+        gchar **groups;
+        gchar *name;
+        guint i;
+
+        key_file = g_key_file_new ();
+        path = get_sources_file ();
+
+        if (g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, NULL)) {
+                groups = g_key_file_get_groups (key_file, NULL);
+                for (i = 0; groups[i]; i++) {
+                        name = g_key_file_get_string (key_file,
+                                                      groups[i],
+                                                      "name",
+                                                      NULL);
+                        if (name) {
+                                func (groups[i], name, user_data);
+                                g_free (name);
+                        }
+                }
+                g_strfreev (groups);
+        }
+
+        g_free (path);
+        g_key_file_free (key_file);
+}
+
+void
+wgp_loader_save_sources (GrlPluginRegistry *registry)
+{
+        GKeyFile *key_file;
+        GList *sources;
+        GList *l;
+        gchar *path;
+        gchar *dir;
+        gchar *data;
+        gsize length;
+
+        key_file = g_key_file_new ();
+
+        sources = grl_plugin_registry_get_sources (registry, FALSE);
+        for (l = sources; l; l = l->next) {
+                g_key_file_set_string (
+                        key_file,
+                        grl_metadata_source_get_id (GRL_METADATA_SOURCE (l->data)),
+                        "name",
+                        grl_metadata_source_get_name (GRL_METADATA_SOURCE (l->data)));
+        }
+        g_list_free (sources);
+
+        path = get_sources_file ();
+        dir = g_path_get_dirname (path);
+        g_mkdir_with_parents (dir, 0700);
+
+        data = g_key_file_to_data (key_file, &length, NULL);
+        if (!g_file_set_contents (path, data, length, NULL)) {
+                g_warning ("Failed to save sources to %s", path);
+        }
+
+        g_free (data);
+        g_free (dir);
+        g_free (path);
+        g_key_file_free (key_file);
+}
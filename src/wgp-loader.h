@@ -0,0 +1,46 @@
+/*
+ * wgp-loader.h: Plugins loading
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_LOADER_H__
+#define __WGP_LOADER_H__
+
+#include <grilo.h>
+
+
+typedef void (*WgpLoaderDoneFunc) (gpointer user_data);
+
+typedef void (*WgpLoaderSourceFunc) (const gchar *source_id,
+                                     const gchar *source_name,
+                                     gpointer user_data);
+
+
+void
+wgp_loader_load_async (GrlPluginRegistry *registry,
+                       WgpLoaderDoneFunc done_func,
+                       gpointer user_data);
+
+void
+wgp_loader_foreach_cached_source (WgpLoaderSourceFunc func,
+                                  gpointer user_data);
+
+void
+wgp_loader_save_sources (GrlPluginRegistry *registry);
+
+
+#endif
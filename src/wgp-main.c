@@ -17,523 +17,408 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
 #include <webkit/webkit.h>
 #include <grilo.h>
 #include "config.h"
-#include "wgp-util.h"
-
-static WebKitDOMDocument *document = NULL;
-static WebKitDOMNode *sources_node = NULL;
-static WebKitDOMNode *main_node = NULL;
-
-static GrlPluginRegistry *registry = NULL;
-
-static GrlMediaSource *current_source = NULL;
-static GList *breadcrumbs_list = NULL;
-
-
-static void
-browse_source_cb (GrlMediaSource *source,
-                  guint browse_id,
-                  GrlMedia *media,
-                  guint remaining,
-                  gpointer user_data,
-                  const GError *error);
-
-static void
-media_clicked_cb (WebKitDOMEventTarget* target,
-                  WebKitDOMEvent* event,
-                  GrlMedia *media);
-
-static void
-source_clicked_cb (WebKitDOMEventTarget* target,
-                   WebKitDOMEvent* event,
-                   GrlMetadataSource *source);
-
-static void
-source_added_cb (GrlPluginRegistry *registry,
-                 GrlMediaPlugin *source,
-                 gpointer user_data);
+#include "wgp-player.h"
+#include "wgp-listing.h"
+#include "wgp-cache.h"
+#include "wgp-thumbnail.h"
+#include "wgp-search.h"
+#include "wgp-trace.h"
+#include "wgp-index.h"
+#include "wgp-prefetch.h"
+#include "wgp-scheduler.h"
+#include "wgp-session.h"
+#include "wgp-crawler.h"
+#include "wgp-watchdog.h"
+
+static gint batch_size = WGP_LISTING_DEFAULT_BATCH_SIZE;
+static gint flush_interval = WGP_LISTING_DEFAULT_FLUSH_INTERVAL;
+static gint cache_size = WGP_CACHE_DEFAULT_BUDGET / 1024;
+static gint cache_ttl = WGP_CACHE_DEFAULT_TTL;
+static gchar **cache_source_ttls = NULL;
+static gint stats_interval = 0;
+static gint thumbnail_workers = WGP_THUMBNAIL_DEFAULT_WORKERS;
+static gint thumbnail_cache_size = WGP_THUMBNAIL_DEFAULT_CACHE_SIZE / 1024 / 1024;
+static gint search_deadline = WGP_SEARCH_DEFAULT_DEADLINE;
+static gchar *trace_filename = NULL;
+static gint index_size = WGP_INDEX_DEFAULT_SIZE / 1024 / 1024;
+static gint prefetch_containers = WGP_PREFETCH_DEFAULT_CONTAINERS;
+static gint prefetch_per_source = WGP_PREFETCH_DEFAULT_PER_SOURCE;
+static gint source_limit = WGP_SCHEDULER_DEFAULT_SOURCE_LIMIT;
+static gint deadline = WGP_SCHEDULER_DEFAULT_DEADLINE;
+static gint retries = WGP_SCHEDULER_DEFAULT_RETRIES;
+static gint session_interval = WGP_SESSION_DEFAULT_INTERVAL;
+static gchar **crawl_source_ids = NULL;
+static gchar *crawl_filename = NULL;
+static gint crawl_jobs = WGP_CRAWLER_DEFAULT_JOBS;
+static gint crawl_max_depth = WGP_CRAWLER_DEFAULT_MAX_DEPTH;
+static gboolean crawl_full = FALSE;
+static gint crawl_wait = WGP_CRAWLER_SOURCE_WAIT;
+static gint watchdog_threshold = 0;
+static gint windows = 1;
+
+static GList *players = NULL;
+static gboolean window_shown = FALSE;
+
+static GOptionEntry entries[] = {
+        { "batch-size", 0, 0, G_OPTION_ARG_INT, &batch_size,
+          "Number of browse results committed to the DOM at once", "N" },
+        { "flush-interval", 0, 0, G_OPTION_ARG_INT, &flush_interval,
+          "Milliseconds to wait before committing pending results", "MS" },
+        { "cache-size", 0, 0, G_OPTION_ARG_INT, &cache_size,
+          "Memory budget of the browse cache", "KB" },
+        { "cache-ttl", 0, 0, G_OPTION_ARG_INT, &cache_ttl,
+          "Seconds before cached browse results are revalidated", "SECONDS" },
+        { "cache-source-ttl", 0, 0, G_OPTION_ARG_STRING_ARRAY, &cache_source_ttls,
+          "Cache TTL for a given source", "SOURCE_ID:SECONDS" },
+        { "stats-interval", 0, 0, G_OPTION_ARG_INT, &stats_interval,
+          "Print memory and cache counters periodically", "SECONDS" },
+        { "thumbnail-workers", 0, 0, G_OPTION_ARG_INT, &thumbnail_workers,
+          "Number of threads generating thumbnails", "N" },
+        { "thumbnail-cache-size", 0, 0, G_OPTION_ARG_INT, &thumbnail_cache_size,
+          "Maximum size of the thumbnails cache on disk", "MB" },
+        { "search-deadline", 0, 0, G_OPTION_ARG_INT, &search_deadline,
+          "Milliseconds to wait for the results of each source", "MS" },
+        { "index-size", 0, 0, G_OPTION_ARG_INT, &index_size,
+          "Maximum size of the index of browsed containers on disk, 0 to disable it",
+          "MB" },
+        { "prefetch", 0, 0, G_OPTION_ARG_INT, &prefetch_containers,
+          "Number of containers prefetched after showing one, 0 to disable it", "N" },
+        { "prefetch-per-source", 0, 0, G_OPTION_ARG_INT, &prefetch_per_source,
+          "Prefetch operations running at once on a source", "N" },
+        { "source-limit", 0, 0, G_OPTION_ARG_INT, &source_limit,
+          "Operations running at once on a source, besides the interactive ones",
+          "N" },
+        { "deadline", 0, 0, G_OPTION_ARG_INT, &deadline,
+          "Milliseconds before giving up on an operation, 0 to wait forever", "MS" },
+        { "retries", 0, 0, G_OPTION_ARG_INT, &retries,
+          "Times a failed operation is retried", "N" },
+        { "session-interval", 0, 0, G_OPTION_ARG_INT, &session_interval,
+          "Seconds between snapshots of the screen shown on next start, "
+          "0 to only save it on exit", "SECONDS" },
+        { "crawl", 0, 0, G_OPTION_ARG_STRING_ARRAY, &crawl_source_ids,
+          "Walk a whole source without opening any window, "
+          "writing a JSON line per media", "SOURCE_ID" },
+        { "crawl-output", 0, 0, G_OPTION_ARG_FILENAME, &crawl_filename,
+          "Write the crawled media to a file instead of the standard output",
+          "FILE" },
+        { "crawl-jobs", 0, 0, G_OPTION_ARG_INT, &crawl_jobs,
+          "Containers browsed at once while crawling", "N" },
+        { "crawl-max-depth", 0, 0, G_OPTION_ARG_INT, &crawl_max_depth,
+          "Deepest containers browsed while crawling", "N" },
+        { "crawl-full", 0, 0, G_OPTION_ARG_NONE, &crawl_full,
+          "Resolve every key of the crawled media, slower but without "
+          "missing URLs and durations", NULL },
+        { "crawl-wait", 0, 0, G_OPTION_ARG_INT, &crawl_wait,
+          "Milliseconds to wait for the crawled sources to show up", "MS" },
+        { "watchdog", 0, 0, G_OPTION_ARG_INT, &watchdog_threshold,
+          "Report main loop stalls of at least MS milliseconds and the callbacks "
+          "causing them, dumped on SIGUSR1 and at exit", "MS" },
+        { "windows", 0, 0, G_OPTION_ARG_INT, &windows,
+          "Number of windows opened, all of them sharing the sources and caches",
+          "N" },
+        { "trace", 0, 0, G_OPTION_ARG_FILENAME, &trace_filename,
+          "Write browse, metadata and DOM timings in Chrome trace format "
+          "(also " WGP_TRACE_ENV " environment variable)", "FILE" },
+        { NULL }
+};
+
+
+static gboolean
+print_stats_cb (gpointer user_data)
+{
+        wgp_player_print_stats ();
 
-static void
-breadcrumbs_set_last (gpointer source_or_media);
+        return TRUE;
+}
 
 
 static void
-plugins_clicked_cb (WebKitDOMEventTarget* target,
-                    WebKitDOMEvent* event,
-                    gpointer user_data)
+save_sessions (void)
 {
-        GList *sources;
         GList *l;
 
-        wgp_util_remove_all_children (main_node);
-        wgp_util_remove_all_children (sources_node);
-
-        webkit_dom_node_set_text_content (
-                main_node,
-                "Grilo plugins",
-                NULL);
-
-        breadcrumbs_set_last (NULL);
-
-        sources = grl_plugin_registry_get_sources (registry, FALSE);
-
-        for (l = sources; l; l = l->next) {
-                source_added_cb (registry, GRL_MEDIA_PLUGIN (l->data), NULL);
+        for (l = players; l; l = l->next) {
+                wgp_player_save_session (l->data);
         }
 }
 
 
-static void
-draw_link (gpointer source_or_media, gpointer node)
+static gboolean
+save_session_cb (gpointer user_data)
 {
-        GrlMetadataSource *source;
-        GrlMedia *media;
-        WebKitDOMNode *breadcrumbs_node;
-        WebKitDOMElement *input;
-        WebKitDOMElement *label;
-        const gchar *title;
-
-        breadcrumbs_node = WEBKIT_DOM_NODE (node);
-
-        input = webkit_dom_document_create_element (document, "input", NULL);
-        webkit_dom_element_set_attribute (input, "type", "radio", NULL);
-        label = webkit_dom_document_create_element (document, "label", NULL);
-
-        if (GRL_IS_MEDIA (source_or_media)) {
-                media = GRL_MEDIA (source_or_media);
-                title = grl_media_get_title (media);
-
-                webkit_dom_element_set_attribute (input, "id", title, NULL);
-                webkit_dom_element_set_attribute (label, "for", title, NULL);
-
-                webkit_dom_node_set_text_content (
-                        WEBKIT_DOM_NODE (label),
-                        g_strdup_printf ("%s", title),
-                        NULL);
-
-                g_signal_connect (label,
-                                  "click-event",
-                                  G_CALLBACK (media_clicked_cb),
-                                  media);
-        } else if (GRL_IS_METADATA_SOURCE (source_or_media)) {
-                source = GRL_METADATA_SOURCE (source_or_media);
-                title = grl_metadata_source_get_name (source);
-
-                webkit_dom_element_set_attribute (input, "id", title, NULL);
-                webkit_dom_element_set_attribute (label, "for", title, NULL);
-
-                webkit_dom_node_set_text_content (
-                        WEBKIT_DOM_NODE (label),
-                        g_strdup_printf ("%s", title),
-                        NULL);
-
-                g_signal_connect (label,
-                                  "click-event",
-                                  G_CALLBACK (source_clicked_cb),
-                                  source);
-        } else {
-                g_error ("Wrong type for source_or_media param");
-        }
+        save_sessions ();
 
-        webkit_dom_node_append_child (breadcrumbs_node,
-                                      WEBKIT_DOM_NODE (input),
-                                      NULL);
-        webkit_dom_node_append_child (breadcrumbs_node,
-                                      WEBKIT_DOM_NODE (label),
-                                      NULL);
+        return TRUE;
 }
 
-static void
-repaint_up_link ()
+
+/*
+ * Saved before the window is gone, the snapshot needs its DOM. Closing any
+ * window quits, so the other ones are saved too.
+ */
+static gboolean
+delete_event_cb (GtkWidget *widget, GdkEvent *event, gpointer user_data)
 {
-        WebKitDOMNode *breadcrumbs_node;
-        WebKitDOMElement *input;
-        WebKitDOMElement *label;
-        WebKitDOMElement *script;
-
-        breadcrumbs_node = WEBKIT_DOM_NODE (
-                webkit_dom_document_get_element_by_id (document, "breadcrumbs"));
-        wgp_util_remove_all_children (breadcrumbs_node);
-
-        input = webkit_dom_document_create_element (document, "input", NULL);
-        webkit_dom_element_set_attribute (input, "type", "radio", NULL);
-        webkit_dom_element_set_attribute (input, "id", "plugins", NULL);
-
-        label = webkit_dom_document_create_element (document, "label", NULL);
-        webkit_dom_element_set_attribute (label, "for", "plugins", NULL);
-        webkit_dom_node_set_text_content (
-                WEBKIT_DOM_NODE (label),
-                "Plugins",
-                NULL);
-        g_signal_connect (label,
-                          "click-event",
-                          G_CALLBACK (plugins_clicked_cb),
-                          NULL);
+        save_sessions ();
 
-        webkit_dom_node_append_child (breadcrumbs_node,
-                                      WEBKIT_DOM_NODE (input),
-                                      NULL);
-        webkit_dom_node_append_child (breadcrumbs_node,
-                                      WEBKIT_DOM_NODE (label),
-                                      NULL);
-
-        g_list_foreach (breadcrumbs_list, draw_link, breadcrumbs_node);
-
-        script = webkit_dom_document_create_element (document, "script", NULL);
-        webkit_dom_node_set_text_content (
-                WEBKIT_DOM_NODE (script),
-                "$('#breadcrumbs').buttonset();",
-                NULL);
-        webkit_dom_node_append_child (breadcrumbs_node,
-                                      WEBKIT_DOM_NODE (script),
-                                      NULL);
+        return FALSE;
 }
 
 
-static void
-breadcrumbs_set_last (gpointer source_or_media)
+/* Mapped, so it is on the screen and not just queued to be shown */
+static gboolean
+map_event_cb (GtkWidget *widget, GdkEvent *event, gpointer user_data)
 {
-        GList *element;
-
-        if (source_or_media == NULL) {
-                breadcrumbs_list = NULL;
-        } else {
-                element = g_list_find (breadcrumbs_list, source_or_media);
-
-                if (element != NULL) {
-                        while (element != g_list_last (breadcrumbs_list)) {
-                                breadcrumbs_list = g_list_remove (
-                                        breadcrumbs_list,
-                                        g_list_last (breadcrumbs_list)->data);
-                        }
-                } else {
-                        breadcrumbs_list = g_list_append (
-                                breadcrumbs_list,
-                                source_or_media);
-                }
+        if (!window_shown) {
+                window_shown = TRUE;
+                wgp_player_startup_mark ("window shown");
         }
 
-        repaint_up_link ();
+        return FALSE;
 }
 
 
 static void
-media_clicked_cb (WebKitDOMEventTarget* target,
-                  WebKitDOMEvent* event,
-                  GrlMedia *media)
+open_window (guint n)
 {
-        WebKitDOMElement *element = NULL;
-        GList * keys;
-        const gchar *title;
-        const gchar *url;
-
-        title = grl_media_get_title (media);
-        g_debug ("Media clicked: '%s'", title);
-
-        wgp_util_remove_all_children (main_node);
-        webkit_dom_node_set_text_content (
-                main_node,
-                g_strdup_printf ("Media selected: %s", title),
-                NULL);
-
-        if (GRL_IS_MEDIA_BOX (media)) {
-                wgp_util_remove_all_children (sources_node);
-
-                g_debug ("Browsing media: %s", title);
-                keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
-                                                  GRL_METADATA_KEY_DURATION,
-                                                  GRL_METADATA_KEY_URL,
-                                                  GRL_METADATA_KEY_CHILDCOUNT,
-                                                  NULL);
-                grl_media_source_browse (current_source,
-                                         media,
-                                         keys,
-                                         0, 100,
-                                         GRL_RESOLVE_IDLE_RELAY,
-                                         browse_source_cb,
-                                         NULL);
-                breadcrumbs_set_last (media);
+        GtkWidget *main_window;
+        GtkWidget *scrolled_window;
+        GtkWidget *web_view;
+        gchar *title;
+
+        main_window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+        if (windows > 1) {
+                title = g_strdup_printf ("Web Grilo Player (%u)", n + 1);
+                gtk_window_set_title (GTK_WINDOW (main_window), title);
+                g_free (title);
         } else {
-                g_debug ("Play media: %s", title);
-                url = grl_media_get_url (media);
+                gtk_window_set_title (GTK_WINDOW (main_window), "Web Grilo Player");
+        }
+        scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+        web_view = webkit_web_view_new ();
 
-                if (GRL_IS_MEDIA_IMAGE (media)) {
-                        element = webkit_dom_document_create_element (document, "img", NULL);
-                }
-                if (GRL_IS_MEDIA_AUDIO (media)) {
-                        element = webkit_dom_document_create_element (document, "audio", NULL);
-                        webkit_dom_element_set_attribute (element, "controls", "controls", NULL);
-                        webkit_dom_element_set_attribute (element, "autoplay", "true", NULL);
-                }
-                if (GRL_IS_MEDIA_VIDEO (media)) {
-                        element = webkit_dom_document_create_element (document, "video", NULL);
-                        webkit_dom_element_set_attribute (element, "controls", "controls", NULL);
-                        webkit_dom_element_set_attribute (element, "autoplay", "true", NULL);
-                        webkit_dom_element_set_attribute (element, "width", "400", NULL);
-                }
+        gtk_container_add (GTK_CONTAINER (scrolled_window), web_view);
+        gtk_container_add (GTK_CONTAINER (main_window), scrolled_window);
 
-                if (element != NULL) {
-                        webkit_dom_node_append_child (
-                                main_node,
-                                WEBKIT_DOM_NODE (webkit_dom_document_create_element (document, "br", NULL)),
-                                NULL);
-
-                        webkit_dom_element_set_attribute (element, "src", url, NULL);
-                        webkit_dom_node_append_child (main_node,
-                                                      WEBKIT_DOM_NODE (element),
-                                                      NULL);
-                } else {
-                        g_error ("Unknown media type");
-                }
-        }
+        players = g_list_append (players,
+                                 wgp_player_new (WEBKIT_WEB_VIEW (web_view),
+                                                 TRUE,
+                                                 NULL,
+                                                 NULL));
+
+        gtk_window_set_default_size (GTK_WINDOW (main_window), 800, 600);
+        g_signal_connect (main_window,
+                          "map-event",
+                          G_CALLBACK (map_event_cb),
+                          NULL);
+        gtk_widget_show_all (main_window);
 
+        g_signal_connect (main_window,
+                          "destroy",
+                          G_CALLBACK (gtk_main_quit),
+                          NULL);
+        g_signal_connect (main_window,
+                          "delete-event",
+                          G_CALLBACK (delete_event_cb),
+                          NULL);
 }
 
 
-static void
-browse_source_cb (GrlMediaSource *source,
-                  guint browse_id,
-                  GrlMedia *media,
-                  guint remaining,
-                  gpointer user_data,
-                  const GError *error)
+static gboolean
+crawl_sources_added (GrlPluginRegistry *registry)
 {
-        WebKitDOMElement *paragraph;
-        const gchar *title;
-        gchar *text;
-
-        if (error) {
-                g_error ("Browse operation failed. Reason: %s", error->message);
-        }
+        guint i;
 
-        if (media) {
-                title = grl_media_get_title (media);
-                paragraph = webkit_dom_document_create_element (document,
-                                                                "p",
-                                                                NULL);
-                webkit_dom_element_set_attribute (paragraph, "id", title, NULL);
-                webkit_dom_element_set_attribute (paragraph,
-                                                  "class",
-                                                  "ui-widget-content",
-                                                  NULL);
-
-                if (GRL_IS_MEDIA_BOX (media)) {
-                        text = g_strdup_printf ("+ %s", title);
-                } else {
-                        text = g_strdup_printf ("- %s", title);
+        for (i = 0; crawl_source_ids[i]; i++) {
+                if (grl_plugin_registry_lookup_source (registry,
+                                                       crawl_source_ids[i]) == NULL) {
+                        return FALSE;
                 }
-                webkit_dom_node_set_text_content (WEBKIT_DOM_NODE (paragraph),
-                                                  text,
-                                                  NULL);
-                webkit_dom_node_append_child (sources_node,
-                                              WEBKIT_DOM_NODE (paragraph),
-                                              NULL);
-
-                current_source = source;
-                g_signal_connect (paragraph,
-                                  "click-event",
-                                  G_CALLBACK (media_clicked_cb),
-                                  media);
         }
 
-        if (remaining == 0) {
-                g_debug ("Browse operation finished!");
-        } else {
-                g_debug ("%d results remaining!", remaining);
-        }
+        return TRUE;
 }
 
-
 static void
-source_clicked_cb (WebKitDOMEventTarget* target,
-                   WebKitDOMEvent* event,
-                   GrlMetadataSource *source)
+crawl_source_added_cb (GrlPluginRegistry *registry,
+                       GrlMediaPlugin *source,
+                       gpointer user_data)
 {
-        const gchar *source_name;
-        GList * keys;
-
-        source_name = grl_metadata_source_get_name (source);
-        g_debug ("Source clicked: '%s'", source_name);
-
-        webkit_dom_node_set_text_content (
-                WEBKIT_DOM_NODE (main_node),
-                g_strdup_printf ("Source selected: %s", source_name),
-                NULL);
-        wgp_util_remove_all_children (sources_node);
-
-        if (grl_metadata_source_supported_operations (source) & GRL_OP_BROWSE) {
-                g_debug ("Browsing source: %s", source_name);
-                keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
-                                                  GRL_METADATA_KEY_DURATION,
-                                                  GRL_METADATA_KEY_URL,
-                                                  GRL_METADATA_KEY_CHILDCOUNT,
-                                                  NULL);
-                grl_media_source_browse (GRL_MEDIA_SOURCE (source),
-                                         NULL,
-                                         keys,
-                                         0, 100,
-                                         GRL_RESOLVE_IDLE_RELAY,
-                                         browse_source_cb,
-                                         NULL);
-                breadcrumbs_set_last (source);
+        if (crawl_sources_added (registry)) {
+                g_main_loop_quit (user_data);
         }
 }
 
-
-static void
-source_added_cb (GrlPluginRegistry *registry,
-                 GrlMediaPlugin *source,
-                 gpointer user_data)
+static gboolean
+crawl_wait_cb (gpointer user_data)
 {
-        WebKitDOMElement *paragraph;
-        const gchar *source_name;
-
-        source_name = grl_metadata_source_get_name (
-                GRL_METADATA_SOURCE (source));
-        g_debug ("Detected new source available: '%s'", source_name);
-
-        paragraph = webkit_dom_document_create_element (document,
-                                                        "p",
-                                                        NULL);
-        webkit_dom_element_set_attribute (paragraph, "id", source_name, NULL);
-        webkit_dom_element_set_attribute (paragraph,
-                                          "class",
-                                          "ui-widget-content",
-                                          NULL);
-
-        webkit_dom_node_set_text_content (WEBKIT_DOM_NODE (paragraph),
-                                          g_strdup_printf ("+ %s", source_name),
-                                          NULL);
-        webkit_dom_node_append_child (sources_node,
-                                      WEBKIT_DOM_NODE (paragraph),
-                                      NULL);
-        g_signal_connect(paragraph,
-                         "click-event",
-                         G_CALLBACK(source_clicked_cb),
-                         GRL_METADATA_SOURCE (source));
-}
+        g_main_loop_quit (user_data);
 
+        return FALSE;
+}
 
+/* Some plugins, like UPnP, add their sources once they are found */
 static void
-load_grilo_plugins ()
+wait_crawl_sources (GrlPluginRegistry *registry)
 {
-        webkit_dom_node_set_text_content (
-                main_node,
-                "Grilo plugins",
-                NULL);
+        GMainLoop *loop;
+        gulong handler;
+        guint timeout_id;
 
-        /* Load grilo plugins */
-        registry = grl_plugin_registry_get_default ();
+        if (crawl_sources_added (registry) || crawl_wait <= 0) {
+                return;
+        }
 
-        g_signal_connect (registry,
-                          "source-added",
-                          G_CALLBACK (source_added_cb),
-                          NULL);
+        loop = g_main_loop_new (NULL, FALSE);
+        handler = g_signal_connect (registry,
+                                    "source-added",
+                                    G_CALLBACK (crawl_source_added_cb),
+                                    loop);
+        timeout_id = g_timeout_add (crawl_wait, crawl_wait_cb, loop);
 
-        if (!grl_plugin_registry_load_all (registry)) {
-                g_error ("Failed to load plugins.");
-        }
-}
+        g_main_loop_run (loop);
 
-static void
-fill_about (WebKitDOMNode *about_node)
-{
-        WebKitDOMNode *about_dialog_node = NULL;
-        WebKitDOMElement *icon = NULL;
-        WebKitDOMElement *element = NULL;
-        gchar *text = NULL;
-
-        icon = webkit_dom_document_create_element (document, "img", NULL);
-        webkit_dom_element_set_attribute (icon, "src", "/usr/share/icons/Tango/32x32/apps/help-browser.png", NULL);
-        webkit_dom_element_set_attribute (icon, "title", "About", NULL);
-        webkit_dom_element_set_attribute (icon, "onClick", "$('#about_dialog').dialog('open');", NULL);
-        webkit_dom_node_append_child (about_node,
-                                      WEBKIT_DOM_NODE (icon),
-                                      NULL);
-
-        element = webkit_dom_document_create_element (document, "p", NULL);
-        text = g_strdup_printf ("%s - %s",
-                                PACKAGE_STRING,
-                                "Desktop application developed in HTML using " \
-                                "WebKitGTK+ to play multimedia content provided by Grilo.");
-        webkit_dom_node_set_text_content (WEBKIT_DOM_NODE (element),
-                                          text,
-                                          NULL);
-
-        about_dialog_node = WEBKIT_DOM_NODE (
-                webkit_dom_document_get_element_by_id (document, "about_dialog"));
-        webkit_dom_node_append_child (about_dialog_node,
-                                      WEBKIT_DOM_NODE (element),
-                                      NULL);
+        if (crawl_sources_added (registry)) {
+                g_source_remove (timeout_id);
+        }
+        g_signal_handler_disconnect (registry, handler);
+        g_main_loop_unref (loop);
 }
 
-static void
-web_view_loaded_cb (WebKitWebView *view,
-                    WebKitWebFrame *frame,
-                    gpointer user_data)
+static gint
+crawl (void)
 {
-        WebKitDOMNode *about_node = NULL;
-
-        document = webkit_web_view_get_dom_document (view);
+        GrlPluginRegistry *registry;
+        GrlMediaPlugin *source;
+        WgpCrawler *crawler;
+        GError *error = NULL;
+        guint errors;
+        guint i;
+
+        crawler = wgp_crawler_new (crawl_filename,
+                                   MAX (crawl_jobs, 1),
+                                   MAX (crawl_max_depth, 0),
+                                   crawl_full ? GRL_RESOLVE_FULL : GRL_RESOLVE_FAST_ONLY,
+                                   &error);
+        if (crawler == NULL) {
+                g_printerr ("%s\n", error->message);
+                g_error_free (error);
+                return 1;
+        }
 
-        sources_node = WEBKIT_DOM_NODE (
-                webkit_dom_document_get_element_by_id (document, "sources"));
-        main_node = WEBKIT_DOM_NODE (
-                webkit_dom_document_get_element_by_id (document, "main"));
-        about_node = WEBKIT_DOM_NODE (
-                webkit_dom_document_get_element_by_id (document, "about"));
+        registry = grl_plugin_registry_get_default ();
+        grl_plugin_registry_load_all (registry);
+        wait_crawl_sources (registry);
+
+        for (i = 0; crawl_source_ids[i]; i++) {
+                source = grl_plugin_registry_lookup_source (registry,
+                                                            crawl_source_ids[i]);
+                if (source == NULL ||
+                    !(grl_metadata_source_supported_operations (
+                              GRL_METADATA_SOURCE (source)) & GRL_OP_BROWSE)) {
+                        g_printerr ("Source can not be browsed: %s\n",
+                                    crawl_source_ids[i]);
+                        wgp_crawler_free (crawler);
+                        return 1;
+                }
+                wgp_crawler_add_source (crawler, GRL_MEDIA_SOURCE (source));
+        }
 
-        /* Initi DOM */
-        breadcrumbs_set_last (NULL);
-        fill_about (about_node);
+        errors = wgp_crawler_run (crawler);
+        wgp_crawler_free (crawler);
 
-        load_grilo_plugins ();
+        return errors > 0 ? 2 : 0;
 }
 
 
 gint
 main (gint argc, gchar **argv)
 {
-        GtkWidget *main_window;
-        GtkWidget *scrolled_window;
-        GtkWidget *web_view;
+        GOptionContext *context;
+        GError *error = NULL;
+        gchar *ttl;
+        gint status;
+        guint i;
 
-        gchar *path_html;
-        gchar *uri_html;
-
-	gtk_init (&argc, &argv);
+        wgp_player_startup_begin ();
 	grl_init (&argc, &argv);
 
-        /* Build URI for index.html file */
-        path_html = HTML_DIR "index.html";
-        uri_html = g_filename_to_uri(path_html, NULL, NULL);
+        /* No display is needed to crawl */
+        context = g_option_context_new ("- Web Grilo Player");
+        g_option_context_add_main_entries (context, entries, NULL);
+        g_option_context_add_group (context, gtk_get_option_group (FALSE));
+        if (!g_option_context_parse (context, &argc, &argv, &error)) {
+                g_printerr ("%s\n", error->message);
+                return 1;
+        }
+        g_option_context_free (context);
 
-        main_window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
-        gtk_window_set_title (GTK_WINDOW (main_window), "Web Grilo Player");
-        scrolled_window = gtk_scrolled_window_new (NULL, NULL);
-        web_view = webkit_web_view_new ();
+        wgp_cache_init ((gsize) MAX (cache_size, 0) * 1024, MAX (cache_ttl, 0));
+        if (!wgp_trace_init (trace_filename, &error)) {
+                g_printerr ("%s\n", error->message);
+                return 1;
+        }
 
-        gtk_container_add (GTK_CONTAINER (scrolled_window), web_view);
-        gtk_container_add (GTK_CONTAINER (main_window), scrolled_window);
+        if (watchdog_threshold > 0) {
+                wgp_watchdog_init (watchdog_threshold);
+        }
 
-        /* Load URI */
-        webkit_web_view_load_uri (WEBKIT_WEB_VIEW (web_view), uri_html);
-        g_signal_connect (web_view,
-                          "document-load-finished",
-                          G_CALLBACK (web_view_loaded_cb),
-                          NULL);
+        wgp_thumbnail_init (MAX (thumbnail_workers, 1),
+                            (gsize) MAX (thumbnail_cache_size, 0) * 1024 * 1024);
+        wgp_scheduler_init (MAX (source_limit, 1),
+                            MAX (deadline, 0),
+                            MAX (retries, 0));
+        if (crawl_source_ids) {
+                status = crawl ();
+                wgp_trace_shutdown ();
+                return status;
+        }
 
-        gtk_window_set_default_size (GTK_WINDOW (main_window), 800, 600);
-        gtk_widget_show_all (main_window);
+        wgp_prefetch_init (MAX (prefetch_containers, 0),
+                           MAX (prefetch_per_source, 1));
+        if (index_size > 0) {
+                wgp_index_init ((gsize) index_size * 1024 * 1024);
+        }
+        for (i = 0; cache_source_ttls && cache_source_ttls[i]; i++) {
+                ttl = strrchr (cache_source_ttls[i], ':');
+                if (ttl == NULL) {
+                        g_printerr ("Wrong cache source TTL: %s\n",
+                                    cache_source_ttls[i]);
+                        return 1;
+                }
+                *ttl = '\0';
+                wgp_cache_set_source_ttl (cache_source_ttls[i],
+                                          g_ascii_strtoull (ttl + 1, NULL, 10));
+        }
 
-        g_signal_connect (main_window,
-                          "destroy",
-                          G_CALLBACK (gtk_main_quit),
-                          NULL);
+        wgp_player_set_batching (MAX (batch_size, 1), MAX (flush_interval, 0));
+        wgp_player_set_search_deadline (MAX (search_deadline, 0));
+
+        gtk_init (&argc, &argv);
+
+        for (i = 0; i < (guint) MAX (windows, 1); i++) {
+                open_window (i);
+        }
+
+        if (stats_interval > 0) {
+                g_timeout_add_seconds (stats_interval, print_stats_cb, NULL);
+        }
+        if (session_interval > 0) {
+                g_timeout_add_seconds (session_interval, save_session_cb, NULL);
+        }
 
         gtk_main ();
 
+        if (stats_interval > 0) {
+                wgp_player_print_stats ();
+        }
+        wgp_watchdog_dump ();
+        wgp_index_shutdown ();
+        wgp_trace_shutdown ();
+
         return 0;
 }
@@ -0,0 +1,268 @@
+/*
+ * wgp-metadata.c: Lazy metadata resolution
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wgp-metadata.h"
+#include "wgp-trace.h"
+
+/*
+ * Browsing only asks for the keys needed to draw a row and the child count,
+ * that tells which boxes are worth prefetching. The rest of them are
+ * resolved later, one item at a time, for the rows that are actually shown
+ * or clicked. A request nobody waits for any more, like the one of a row
+ * scrolled out of view, is demoted to background priority until it is asked
+ * for again or cancelled.
+ */
+
+typedef struct {
+        WgpMetadataFunc func;
+        gpointer user_data;
+} Waiter;
+
+typedef struct {
+        GrlMedia *media;
+        WgpOperation *operation;
+        WgpSchedulerPriority priority;
+        GList *waiters;
+        gboolean cancelled;
+} Request;
+
+static GHashTable *requests = NULL;
+static GQuark resolved_quark = 0;
+
+
+static const GList *
+get_slow_keys (void)
+{
+        static GList *keys = NULL;
+
+        if (keys == NULL) {
+                keys = grl_metadata_key_list_new (GRL_METADATA_KEY_DURATION,
+                                                  GRL_METADATA_KEY_URL,
+                                                  GRL_METADATA_KEY_THUMBNAIL,
+                                                  NULL);
+        }
+
+        return keys;
+}
+
+static void
+metadata_cb (GrlMediaSource *source,
+             GrlMedia *media,
+             gpointer user_data,
+             const GError *error)
+{
+        Request *request = user_data;
+        GrlMedia *requested = request->media;
+        GList *waiters;
+        GList *l;
+        Waiter *waiter;
+
+        /* Already out of the table, keep what a running one got */
+        if (request->cancelled) {
+                if (error == NULL) {
+                        g_object_set_qdata (G_OBJECT (requested),
+                                            resolved_quark,
+                                            GUINT_TO_POINTER (1));
+                }
+                wgp_trace_end ("metadata", "resolve", GPOINTER_TO_SIZE (requested),
+                               "\"cancelled\": true");
+                g_object_unref (requested);
+                g_slice_free (Request, request);
+                return;
+        }
+
+        if (error) {
+                g_warning ("Metadata operation failed. Reason: %s",
+                           error->message);
+        }
+
+        /* Mark it even on failure, so it is not requested again and again */
+        g_object_set_qdata (G_OBJECT (requested),
+                            resolved_quark,
+                            GUINT_TO_POINTER (1));
+
+        g_hash_table_remove (requests, requested);
+        waiters = request->waiters;
+        g_slice_free (Request, request);
+
+        wgp_trace_end ("metadata", "resolve", GPOINTER_TO_SIZE (requested),
+                       "\"waiters\": %u, \"failed\": %s",
+                       g_list_length (waiters),
+                       error ? "true" : "false");
+
+        for (l = waiters; l; l = l->next) {
+                waiter = l->data;
+                waiter->func (requested, waiter->user_data);
+                g_slice_free (Waiter, waiter);
+        }
+        g_list_free (waiters);
+
+        g_object_unref (requested);
+}
+
+
+const GList *
+wgp_metadata_get_fast_keys (void)
+{
+        static GList *keys = NULL;
+
+        if (keys == NULL) {
+                keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                                  GRL_METADATA_KEY_CHILDCOUNT,
+                                                  NULL);
+        }
+
+        return keys;
+}
+
+gboolean
+wgp_metadata_is_resolved (GrlMedia *media)
+{
+        return resolved_quark != 0 &&
+                g_object_get_qdata (G_OBJECT (media), resolved_quark) != NULL;
+}
+
+/*
+ * Resolves the slow keys of @media and calls @func once they are there.
+ * Requests for an item already being resolved are coalesced, and take the
+ * highest priority they have been asked with.
+ */
+void
+wgp_metadata_resolve (WgpSchedulerPriority priority,
+                      GrlMediaSource *source,
+                      GrlMedia *media,
+                      WgpMetadataFunc func,
+                      gpointer user_data)
+{
+        Waiter *waiter;
+        Request *request;
+
+        if (requests == NULL) {
+                requests = g_hash_table_new (g_direct_hash, g_direct_equal);
+                resolved_quark = g_quark_from_static_string ("wgp-metadata-resolved");
+        }
+
+        if (wgp_metadata_is_resolved (media)) {
+                func (media, user_data);
+                return;
+        }
+
+        waiter = g_slice_new (Waiter);
+        waiter->func = func;
+        waiter->user_data = user_data;
+
+        request = g_hash_table_lookup (requests, media);
+        if (request) {
+                request->waiters = g_list_append (request->waiters, waiter);
+                if (priority < request->priority) {
+                        request->priority = priority;
+                        wgp_scheduler_promote (request->operation, priority);
+                }
+                return;
+        }
+
+        request = g_slice_new0 (Request);
+        request->media = g_object_ref (media);
+        request->priority = priority;
+        request->waiters = g_list_append (NULL, waiter);
+        g_hash_table_insert (requests, media, request);
+
+        g_debug ("Resolving metadata: %s", grl_media_get_title (media));
+        wgp_trace_begin ("metadata", "resolve", GPOINTER_TO_SIZE (media),
+                         NULL);
+        request->operation = wgp_scheduler_metadata (
+                priority,
+                source,
+                media,
+                get_slow_keys (),
+                GRL_RESOLVE_IDLE_RELAY | GRL_RESOLVE_FULL,
+                metadata_cb,
+                request);
+}
+
+static gboolean
+remove_waiter (Request *request, WgpMetadataFunc func, gpointer user_data)
+{
+        Waiter *waiter;
+        GList *l;
+
+        for (l = request->waiters; l; l = l->next) {
+                waiter = l->data;
+                if (waiter->func == func && waiter->user_data == user_data) {
+                        request->waiters = g_list_delete_link (request->waiters, l);
+                        g_slice_free (Waiter, waiter);
+                        return TRUE;
+                }
+        }
+
+        return FALSE;
+}
+
+/*
+ * @func is not called for @media any more. If nobody else waits for it the
+ * request goes on at background priority, and it is promoted again if
+ * @media is asked for before it is resolved.
+ */
+void
+wgp_metadata_release (GrlMedia *media,
+                      WgpMetadataFunc func,
+                      gpointer user_data)
+{
+        Request *request;
+
+        if (requests == NULL) {
+                return;
+        }
+
+        request = g_hash_table_lookup (requests, media);
+        if (request == NULL || !remove_waiter (request, func, user_data)) {
+                return;
+        }
+
+        if (request->waiters == NULL) {
+                request->priority = WGP_SCHEDULER_BACKGROUND;
+                wgp_scheduler_demote (request->operation, WGP_SCHEDULER_BACKGROUND);
+        }
+}
+
+/*
+ * Drops every wait of @func with @user_data, and cancels the requests nobody
+ * waits for, the released ones included.
+ */
+void
+wgp_metadata_cancel_all (WgpMetadataFunc func, gpointer user_data)
+{
+        GHashTableIter iter;
+        Request *request;
+
+        if (requests == NULL) {
+                return;
+        }
+
+        g_hash_table_iter_init (&iter, requests);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &request)) {
+                while (remove_waiter (request, func, user_data));
+
+                if (request->waiters == NULL) {
+                        g_hash_table_iter_remove (&iter);
+                        request->cancelled = TRUE;
+                        wgp_scheduler_cancel (request->operation);
+                }
+        }
+}
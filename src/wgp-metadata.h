@@ -0,0 +1,52 @@
+/*
+ * wgp-metadata.h: Lazy metadata resolution
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_METADATA_H__
+#define __WGP_METADATA_H__
+
+#include <grilo.h>
+#include "wgp-scheduler.h"
+
+
+typedef void (*WgpMetadataFunc) (GrlMedia *media, gpointer user_data);
+
+
+const GList *
+wgp_metadata_get_fast_keys (void);
+
+gboolean
+wgp_metadata_is_resolved (GrlMedia *media);
+
+void
+wgp_metadata_resolve (WgpSchedulerPriority priority,
+                      GrlMediaSource *source,
+                      GrlMedia *media,
+                      WgpMetadataFunc func,
+                      gpointer user_data);
+
+void
+wgp_metadata_release (GrlMedia *media,
+                      WgpMetadataFunc func,
+                      gpointer user_data);
+
+void
+wgp_metadata_cancel_all (WgpMetadataFunc func, gpointer user_data);
+
+
+#endif
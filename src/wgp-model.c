@@ -0,0 +1,826 @@
+/*
+ * wgp-model.c: Columnar store of the listed items
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <grilo.h>
+#include "wgp-model.h"
+
+#define STRINGS_CHUNK_SIZE 16384
+
+/*
+ * Every field shown or used to sort and filter the listing is copied from the
+ * objects to its own array when the object is appended, so the rows can be
+ * drawn, sorted and filtered without touching the objects, which are only
+ * borrowed to be handed back when a row is clicked. Strings are interned in
+ * a string chunk freed at once when the model is cleared.
+ *
+ * The positions of the shown rows are kept apart in an array of row numbers
+ * sorted and filtered on each change, and the position of every row in a
+ * column of its own. When sorted, appended rows wait at the end of the array,
+ * not shown, until wgp_model_sort_appended() sorts them and merges them at
+ * once with the shown ones.
+ *
+ * Durations are mostly resolved after the rows are shown. Sorting by
+ * duration uses the one the row had when it was placed, and a row placed
+ * with an unknown one keeps its position when its duration arrives, so rows
+ * do not jump around while they are resolved. They are put in place the next
+ * time the sort is set.
+ *
+ * Filtering is helped by an index from every trigram (three bytes) of the
+ * folded titles to the rows having it, filled as rows are appended. Only the
+ * rows in the shortest list of the trigrams of the filter are checked, or
+ * the rows already shown when the filter is just made longer.
+ */
+struct _WgpModel {
+        GStringChunk *strings;
+        GHashTable *rows_by_object;
+
+        GPtrArray *objects;
+        GArray *titles;
+        GArray *sort_keys;
+        GArray *folded_titles;
+        GArray *urls;
+        GArray *durations;
+        GArray *sort_durations;
+        GArray *childcounts;
+        GArray *types;
+        GArray *positions;
+
+        GArray *order;
+        guint appended;
+        GHashTable *trigrams;
+        guint indexed_rows;
+
+        WgpModelSort sort;
+        gboolean descending;
+        gchar *filter;
+};
+
+#define COLUMN(model, column, type, row)                        \
+        g_array_index ((model)->column, type, (row))
+
+#define TRIGRAM(s)                                                      \
+        GUINT_TO_POINTER (((guchar) (s)[0] << 16) |                     \
+                          ((guchar) (s)[1] << 8) |                      \
+                          (guchar) (s)[2])
+
+
+static const gchar *
+intern (WgpModel *model, const gchar *string)
+{
+        if (string == NULL) {
+                return NULL;
+        }
+
+        return g_string_chunk_insert_const (model->strings, string);
+}
+
+static void
+posting_free (gpointer posting)
+{
+        g_array_free (posting, TRUE);
+}
+
+/* Postings are kept sorted by row */
+static void
+index_row (WgpModel *model, guint row, const gchar *folded)
+{
+        GArray *posting;
+        const gchar *p;
+        guint last;
+        guint i;
+
+        for (p = folded; p[0] && p[1] && p[2]; p++) {
+                posting = g_hash_table_lookup (model->trigrams, TRIGRAM (p));
+                if (posting == NULL) {
+                        posting = g_array_new (FALSE, FALSE, sizeof (guint));
+                        g_hash_table_insert (model->trigrams, TRIGRAM (p), posting);
+                }
+
+                if (posting->len == 0 ||
+                    (last = g_array_index (posting, guint, posting->len - 1)) < row) {
+                        g_array_append_val (posting, row);
+                } else if (last != row) {
+                        /* Only when the title of an old row changes */
+                        for (i = 0; g_array_index (posting, guint, i) < row; i++);
+                        if (g_array_index (posting, guint, i) != row) {
+                                g_array_insert_val (posting, i, row);
+                        }
+                }
+        }
+}
+
+static void
+unindex_rows (WgpModel *model, guint n_rows)
+{
+        GHashTableIter iter;
+        GArray *posting;
+
+        g_hash_table_iter_init (&iter, model->trigrams);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &posting)) {
+                while (posting->len > 0 &&
+                       g_array_index (posting, guint, posting->len - 1) >= n_rows) {
+                        g_array_set_size (posting, posting->len - 1);
+                }
+        }
+}
+
+static void
+set_row (WgpModel *model, guint row, gpointer object)
+{
+        GrlMedia *media = NULL;
+        WgpModelType type;
+        const gchar *title;
+        const gchar *folded_title;
+        gchar *key;
+        gchar *folded;
+
+        if (GRL_IS_MEDIA_BOX (object)) {
+                type = WGP_MODEL_TYPE_BOX;
+        } else if (GRL_IS_MEDIA_VIDEO (object)) {
+                type = WGP_MODEL_TYPE_VIDEO;
+        } else if (GRL_IS_MEDIA_AUDIO (object)) {
+                type = WGP_MODEL_TYPE_AUDIO;
+        } else if (GRL_IS_MEDIA_IMAGE (object)) {
+                type = WGP_MODEL_TYPE_IMAGE;
+        } else if (GRL_IS_MEDIA (object)) {
+                type = WGP_MODEL_TYPE_MEDIA;
+        } else {
+                type = WGP_MODEL_TYPE_SOURCE;
+        }
+
+        if (type == WGP_MODEL_TYPE_SOURCE) {
+                title = grl_metadata_source_get_name (GRL_METADATA_SOURCE (object));
+        } else {
+                media = GRL_MEDIA (object);
+                title = grl_media_get_title (media);
+        }
+        title = intern (model, title ? title : "");
+
+        key = g_utf8_collate_key (title, -1);
+        folded = g_utf8_casefold (title, -1);
+
+        /* Interned, so an unchanged title is the same string */
+        folded_title = intern (model, folded);
+        if (row >= model->indexed_rows ||
+            COLUMN (model, folded_titles, const gchar *, row) != folded_title) {
+                index_row (model, row, folded_title);
+        }
+        model->indexed_rows = MAX (model->indexed_rows, row + 1);
+
+        g_ptr_array_index (model->objects, row) = object;
+        COLUMN (model, titles, const gchar *, row) = title;
+        COLUMN (model, sort_keys, const gchar *, row) = intern (model, key);
+        COLUMN (model, folded_titles, const gchar *, row) = folded_title;
+        COLUMN (model, types, guint8, row) = type;
+
+        if (media) {
+                COLUMN (model, urls, const gchar *, row) =
+                        intern (model, grl_media_get_url (media));
+                COLUMN (model, durations, gint, row) =
+                        grl_media_get_duration (media);
+        } else {
+                COLUMN (model, urls, const gchar *, row) = NULL;
+                COLUMN (model, durations, gint, row) = 0;
+        }
+
+        if (type == WGP_MODEL_TYPE_BOX) {
+                COLUMN (model, childcounts, gint, row) =
+                        grl_media_box_get_childcount (GRL_MEDIA_BOX (media));
+        } else {
+                COLUMN (model, childcounts, gint, row) = 0;
+        }
+
+        g_free (key);
+        g_free (folded);
+}
+
+static void
+set_n_rows (WgpModel *model, guint n_rows)
+{
+        g_ptr_array_set_size (model->objects, n_rows);
+        g_array_set_size (model->titles, n_rows);
+        g_array_set_size (model->sort_keys, n_rows);
+        g_array_set_size (model->folded_titles, n_rows);
+        g_array_set_size (model->urls, n_rows);
+        g_array_set_size (model->durations, n_rows);
+        g_array_set_size (model->sort_durations, n_rows);
+        g_array_set_size (model->childcounts, n_rows);
+        g_array_set_size (model->types, n_rows);
+        g_array_set_size (model->positions, n_rows);
+}
+
+/* Ties are broken by the row number, so rows keep the browse order */
+static gint
+compare_rows (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+        WgpModel *model = user_data;
+        guint row_a = *(const guint *) a;
+        guint row_b = *(const guint *) b;
+        gint result = 0;
+        gint value_a;
+        gint value_b;
+
+        switch (model->sort) {
+        case WGP_MODEL_SORT_NONE:
+                break;
+        case WGP_MODEL_SORT_TYPE:
+                value_a = COLUMN (model, types, guint8, row_a);
+                value_b = COLUMN (model, types, guint8, row_b);
+                result = value_a - value_b;
+                if (result != 0) {
+                        break;
+                }
+                /* Fall through, same types are sorted by title */
+        case WGP_MODEL_SORT_TITLE:
+                result = strcmp (COLUMN (model, sort_keys, const gchar *, row_a),
+                                 COLUMN (model, sort_keys, const gchar *, row_b));
+                break;
+        case WGP_MODEL_SORT_DURATION:
+                value_a = COLUMN (model, sort_durations, gint, row_a);
+                value_b = COLUMN (model, sort_durations, gint, row_b);
+                result = (value_a > value_b) - (value_a < value_b);
+                break;
+        }
+
+        if (model->descending) {
+                result = -result;
+        }
+
+        if (result == 0) {
+                result = (row_a > row_b) - (row_a < row_b);
+        }
+
+        return result;
+}
+
+static gboolean
+row_matches (WgpModel *model, guint row)
+{
+        return model->filter == NULL ||
+                strstr (COLUMN (model, folded_titles, const gchar *, row),
+                        model->filter) != NULL;
+}
+
+static void
+set_positions (WgpModel *model, guint start, guint end)
+{
+        guint i;
+
+        for (i = start; i < end; i++) {
+                COLUMN (model, positions, guint, COLUMN (model, order, guint, i)) = i;
+        }
+}
+
+static void
+reset_positions (WgpModel *model)
+{
+        guint row;
+
+        for (row = 0; row < model->objects->len; row++) {
+                COLUMN (model, positions, guint, row) = WGP_MODEL_HIDDEN;
+        }
+        set_positions (model, 0, model->order->len);
+}
+
+/* First position from @low to @high whose row goes after @row */
+static guint
+find_position (WgpModel *model, guint row, guint low, guint high)
+{
+        guint middle;
+
+        while (low < high) {
+                middle = (low + high) / 2;
+                if (compare_rows (&COLUMN (model, order, guint, middle),
+                                  &row,
+                                  model) < 0) {
+                        low = middle + 1;
+                } else {
+                        high = middle;
+                }
+        }
+
+        return low;
+}
+
+/* Returns the position where @row is shown */
+static guint
+show_row (WgpModel *model, guint row)
+{
+        guint position;
+
+        position = find_position (model, row, 0, wgp_model_get_length (model));
+        g_array_insert_val (model->order, position, row);
+        set_positions (model, position, model->order->len);
+
+        return position;
+}
+
+static void
+hide_row (WgpModel *model, guint position)
+{
+        COLUMN (model, positions, guint, COLUMN (model, order, guint, position)) =
+                WGP_MODEL_HIDDEN;
+        g_array_remove_index (model->order, position);
+        set_positions (model, position, model->order->len);
+}
+
+/* Puts in place the row at @position, only the rows in between are moved */
+static guint
+move_row (WgpModel *model, guint position)
+{
+        guint *order = (guint *) model->order->data;
+        guint length = wgp_model_get_length (model);
+        guint row = order[position];
+        guint target;
+
+        if (position > 0 &&
+            compare_rows (&order[position - 1], &row, model) > 0) {
+                target = find_position (model, row, 0, position);
+                memmove (&order[target + 1],
+                         &order[target],
+                         (position - target) * sizeof (guint));
+                order[target] = row;
+                set_positions (model, target, position + 1);
+                return target;
+        }
+
+        if (position + 1 < length &&
+            compare_rows (&order[position + 1], &row, model) < 0) {
+                target = find_position (model, row, position + 1, length) - 1;
+                memmove (&order[position],
+                         &order[position + 1],
+                         (target - position) * sizeof (guint));
+                order[target] = row;
+                set_positions (model, position, target + 1);
+                return target;
+        }
+
+        return position;
+}
+
+/* Shortest list of rows having every trigram of the filter, or NULL */
+static GArray *
+get_candidates (WgpModel *model)
+{
+        GArray *posting;
+        GArray *shortest = NULL;
+        const gchar *p;
+        static GArray *empty = NULL;
+
+        for (p = model->filter; p[0] && p[1] && p[2]; p++) {
+                posting = g_hash_table_lookup (model->trigrams, TRIGRAM (p));
+                if (posting == NULL) {
+                        /* No row can match */
+                        if (empty == NULL) {
+                                empty = g_array_new (FALSE, FALSE, sizeof (guint));
+                        }
+                        return empty;
+                }
+                if (shortest == NULL || posting->len < shortest->len) {
+                        shortest = posting;
+                }
+        }
+
+        return shortest;
+}
+
+static void
+rebuild_order (WgpModel *model, gboolean narrowing)
+{
+        GArray *candidates = NULL;
+        GArray *order;
+        guint row;
+        guint i;
+
+        wgp_model_sort_appended (model);
+
+        if (model->filter) {
+                candidates = get_candidates (model);
+        }
+
+        /* The shown rows are already sorted, no need to sort them again */
+        if (narrowing &&
+            (candidates == NULL || model->order->len <= candidates->len)) {
+                order = g_array_sized_new (FALSE, FALSE, sizeof (guint),
+                                           model->order->len);
+                for (i = 0; i < model->order->len; i++) {
+                        row = COLUMN (model, order, guint, i);
+                        if (row_matches (model, row)) {
+                                g_array_append_val (order, row);
+                        }
+                }
+                g_array_free (model->order, TRUE);
+                model->order = order;
+                reset_positions (model);
+                return;
+        }
+
+        g_array_set_size (model->order, 0);
+        if (candidates) {
+                for (i = 0; i < candidates->len; i++) {
+                        row = g_array_index (candidates, guint, i);
+                        if (row_matches (model, row)) {
+                                g_array_append_val (model->order, row);
+                        }
+                }
+        } else {
+                for (row = 0; row < model->objects->len; row++) {
+                        if (row_matches (model, row)) {
+                                g_array_append_val (model->order, row);
+                        }
+                }
+        }
+
+        if (model->sort != WGP_MODEL_SORT_NONE) {
+                g_array_sort_with_data (model->order, compare_rows, model);
+        }
+        reset_positions (model);
+}
+
+
+WgpModel *
+wgp_model_new (void)
+{
+        WgpModel *model;
+
+        model = g_slice_new0 (WgpModel);
+        model->strings = g_string_chunk_new (STRINGS_CHUNK_SIZE);
+        model->rows_by_object = g_hash_table_new (g_direct_hash, g_direct_equal);
+        model->objects = g_ptr_array_new ();
+        model->titles = g_array_new (FALSE, FALSE, sizeof (const gchar *));
+        model->sort_keys = g_array_new (FALSE, FALSE, sizeof (const gchar *));
+        model->folded_titles = g_array_new (FALSE, FALSE, sizeof (const gchar *));
+        model->urls = g_array_new (FALSE, FALSE, sizeof (const gchar *));
+        model->durations = g_array_new (FALSE, FALSE, sizeof (gint));
+        model->sort_durations = g_array_new (FALSE, FALSE, sizeof (gint));
+        model->childcounts = g_array_new (FALSE, FALSE, sizeof (gint));
+        model->types = g_array_new (FALSE, FALSE, sizeof (guint8));
+        model->positions = g_array_new (FALSE, FALSE, sizeof (guint));
+        model->order = g_array_new (FALSE, FALSE, sizeof (guint));
+        model->trigrams = g_hash_table_new_full (g_direct_hash,
+                                                 g_direct_equal,
+                                                 NULL,
+                                                 posting_free);
+
+        return model;
+}
+
+void
+wgp_model_free (WgpModel *model)
+{
+        g_string_chunk_free (model->strings);
+        g_hash_table_destroy (model->rows_by_object);
+        g_ptr_array_free (model->objects, TRUE);
+        g_array_free (model->titles, TRUE);
+        g_array_free (model->sort_keys, TRUE);
+        g_array_free (model->folded_titles, TRUE);
+        g_array_free (model->urls, TRUE);
+        g_array_free (model->durations, TRUE);
+        g_array_free (model->sort_durations, TRUE);
+        g_array_free (model->childcounts, TRUE);
+        g_array_free (model->types, TRUE);
+        g_array_free (model->positions, TRUE);
+        g_array_free (model->order, TRUE);
+        g_hash_table_destroy (model->trigrams);
+        g_free (model->filter);
+        g_slice_free (WgpModel, model);
+}
+
+/* Removes every row, the sort and filter are kept */
+void
+wgp_model_clear (WgpModel *model)
+{
+        set_n_rows (model, 0);
+        g_array_set_size (model->order, 0);
+        model->appended = 0;
+        g_hash_table_remove_all (model->rows_by_object);
+        g_hash_table_remove_all (model->trigrams);
+        model->indexed_rows = 0;
+        g_string_chunk_clear (model->strings);
+}
+
+/*
+ * Copies the fields of @object (a source or a media) to a new row. Returns
+ * its position, or WGP_MODEL_HIDDEN if it does not match the filter or the
+ * model is sorted, then it is shown by wgp_model_sort_appended().
+ */
+guint
+wgp_model_append (WgpModel *model, gpointer object)
+{
+        guint row;
+
+        row = model->objects->len;
+        set_n_rows (model, row + 1);
+        set_row (model, row, object);
+        COLUMN (model, sort_durations, gint, row) =
+                COLUMN (model, durations, gint, row);
+        COLUMN (model, positions, guint, row) = WGP_MODEL_HIDDEN;
+        g_hash_table_insert (model->rows_by_object,
+                             object,
+                             GUINT_TO_POINTER (row + 1));
+
+        if (!row_matches (model, row)) {
+                return WGP_MODEL_HIDDEN;
+        }
+
+        g_array_append_val (model->order, row);
+        COLUMN (model, positions, guint, row) = model->order->len - 1;
+        if (model->sort != WGP_MODEL_SORT_NONE) {
+                model->appended++;
+                return WGP_MODEL_HIDDEN;
+        }
+
+        return model->order->len - 1;
+}
+
+/*
+ * Sorts the rows appended since the last call and merges them with the shown
+ * ones. Returns the first position that changed, or WGP_MODEL_HIDDEN.
+ */
+guint
+wgp_model_sort_appended (WgpModel *model)
+{
+        guint *order = (guint *) model->order->data;
+        guint *appended;
+        guint length;
+        guint first;
+        guint i;
+        guint j;
+        guint k;
+
+        if (model->appended == 0) {
+                return WGP_MODEL_HIDDEN;
+        }
+
+        length = wgp_model_get_length (model);
+        appended = &order[length];
+        g_qsort_with_data (appended,
+                           model->appended,
+                           sizeof (guint),
+                           compare_rows,
+                           model);
+
+        first = find_position (model, appended[0], 0, length);
+        if (first < length) {
+                /* Merged from the end, the appended ones are copied apart */
+                appended = g_memdup (appended, model->appended * sizeof (guint));
+                i = length;
+                j = model->appended;
+                k = model->order->len;
+                while (j > 0) {
+                        if (i > first &&
+                            compare_rows (&order[i - 1], &appended[j - 1], model) > 0) {
+                                order[--k] = order[--i];
+                        } else {
+                                order[--k] = appended[--j];
+                        }
+                }
+                g_free (appended);
+        }
+
+        model->appended = 0;
+        set_positions (model, first, model->order->len);
+
+        return first;
+}
+
+/* Copies again the fields of @object, returns its new position */
+guint
+wgp_model_update (WgpModel *model, gpointer object)
+{
+        const gchar *sort_key;
+        gint sort_duration;
+        guint position;
+        guint row;
+
+        if (!wgp_model_lookup (model, object, &row)) {
+                return WGP_MODEL_HIDDEN;
+        }
+
+        position = COLUMN (model, positions, guint, row);
+        sort_key = COLUMN (model, sort_keys, const gchar *, row);
+        set_row (model, row, object);
+
+        sort_duration = COLUMN (model, sort_durations, gint, row);
+        if (sort_duration != 0) {
+                COLUMN (model, sort_durations, gint, row) =
+                        COLUMN (model, durations, gint, row);
+        }
+
+        /* Not merged yet, it is put in place with the other appended ones */
+        if (position != WGP_MODEL_HIDDEN &&
+            position >= wgp_model_get_length (model)) {
+                if (!row_matches (model, row)) {
+                        hide_row (model, position);
+                        model->appended--;
+                }
+                return WGP_MODEL_HIDDEN;
+        }
+
+        if (!row_matches (model, row)) {
+                if (position != WGP_MODEL_HIDDEN) {
+                        hide_row (model, position);
+                }
+                return WGP_MODEL_HIDDEN;
+        }
+
+        if (position == WGP_MODEL_HIDDEN) {
+                return show_row (model, row);
+        }
+
+        /* Sort keys are interned, an unchanged one is the same string */
+        if (sort_key == COLUMN (model, sort_keys, const gchar *, row) &&
+            sort_duration == COLUMN (model, sort_durations, gint, row)) {
+                return position;
+        }
+
+        return move_row (model, position);
+}
+
+/* Drops the rows from @n_rows on */
+void
+wgp_model_truncate (WgpModel *model, guint n_rows)
+{
+        guint length;
+        guint row;
+        guint i;
+        guint j;
+
+        if (n_rows >= model->objects->len) {
+                return;
+        }
+
+        for (row = n_rows; row < model->objects->len; row++) {
+                g_hash_table_remove (model->rows_by_object,
+                                     g_ptr_array_index (model->objects, row));
+        }
+        set_n_rows (model, n_rows);
+        unindex_rows (model, n_rows);
+        model->indexed_rows = n_rows;
+
+        length = wgp_model_get_length (model);
+        model->appended = 0;
+        for (i = 0, j = 0; i < model->order->len; i++) {
+                row = COLUMN (model, order, guint, i);
+                if (row < n_rows) {
+                        COLUMN (model, order, guint, j++) = row;
+                        if (i >= length) {
+                                model->appended++;
+                        }
+                }
+        }
+        g_array_set_size (model->order, j);
+        set_positions (model, 0, j);
+}
+
+/* Number of rows, shown or not */
+guint
+wgp_model_get_n_rows (WgpModel *model)
+{
+        return model->objects->len;
+}
+
+/* Number of rows shown */
+guint
+wgp_model_get_length (WgpModel *model)
+{
+        return model->order->len - model->appended;
+}
+
+/* Row shown at @position */
+guint
+wgp_model_get_row (WgpModel *model, guint position)
+{
+        return COLUMN (model, order, guint, position);
+}
+
+gpointer
+wgp_model_get_object (WgpModel *model, guint row)
+{
+        return g_ptr_array_index (model->objects, row);
+}
+
+const gchar *
+wgp_model_get_title (WgpModel *model, guint row)
+{
+        return COLUMN (model, titles, const gchar *, row);
+}
+
+const gchar *
+wgp_model_get_url (WgpModel *model, guint row)
+{
+        return COLUMN (model, urls, const gchar *, row);
+}
+
+gint
+wgp_model_get_duration (WgpModel *model, guint row)
+{
+        return COLUMN (model, durations, gint, row);
+}
+
+gint
+wgp_model_get_childcount (WgpModel *model, guint row)
+{
+        return COLUMN (model, childcounts, gint, row);
+}
+
+WgpModelType
+wgp_model_get_item_type (WgpModel *model, guint row)
+{
+        return COLUMN (model, types, guint8, row);
+}
+
+gboolean
+wgp_model_lookup (WgpModel *model, gpointer object, guint *row)
+{
+        gpointer value;
+
+        value = g_hash_table_lookup (model->rows_by_object, object);
+        if (value == NULL) {
+                return FALSE;
+        }
+
+        *row = GPOINTER_TO_UINT (value) - 1;
+
+        return TRUE;
+}
+
+void
+wgp_model_set_sort (WgpModel *model,
+                    WgpModelSort sort,
+                    gboolean descending)
+{
+        if (sort == model->sort && descending == model->descending) {
+                wgp_model_sort_appended (model);
+                return;
+        }
+
+        model->sort = sort;
+        model->descending = descending;
+
+        /* The durations resolved meanwhile are taken now */
+        memcpy (model->sort_durations->data,
+                model->durations->data,
+                model->objects->len * sizeof (gint));
+
+        g_array_sort_with_data (model->order, compare_rows, model);
+        model->appended = 0;
+        set_positions (model, 0, model->order->len);
+}
+
+/* Only rows with @text in their title are shown, NULL or "" shows them all */
+void
+wgp_model_set_filter (WgpModel *model, const gchar *text)
+{
+        gchar *filter = NULL;
+        gboolean narrowing;
+
+        if (text && *text) {
+                filter = g_utf8_casefold (text, -1);
+        }
+
+        if (g_strcmp0 (filter, model->filter) == 0) {
+                g_free (filter);
+                return;
+        }
+
+        /* Typing one more letter only hides rows */
+        narrowing = filter && model->filter && strstr (filter, model->filter);
+
+        g_free (model->filter);
+        model->filter = filter;
+
+        rebuild_order (model, narrowing);
+}
+
+WgpModelSort
+wgp_model_get_sort (WgpModel *model, gboolean *descending)
+{
+        *descending = model->descending;
+
+        return model->sort;
+}
+
+/* Case folded text of the filter, or NULL */
+const gchar *
+wgp_model_get_filter (WgpModel *model)
+{
+        return model->filter;
+}
@@ -0,0 +1,115 @@
+/*
+ * wgp-model.h: Columnar store of the listed items
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_MODEL_H__
+#define __WGP_MODEL_H__
+
+#include <glib.h>
+
+
+typedef enum {
+        WGP_MODEL_TYPE_SOURCE,
+        WGP_MODEL_TYPE_BOX,
+        WGP_MODEL_TYPE_VIDEO,
+        WGP_MODEL_TYPE_AUDIO,
+        WGP_MODEL_TYPE_IMAGE,
+        WGP_MODEL_TYPE_MEDIA
+} WgpModelType;
+
+typedef enum {
+        WGP_MODEL_SORT_NONE,
+        WGP_MODEL_SORT_TITLE,
+        WGP_MODEL_SORT_DURATION,
+        WGP_MODEL_SORT_TYPE
+} WgpModelSort;
+
+/* Returned as position of the rows hidden by the filter */
+#define WGP_MODEL_HIDDEN G_MAXUINT
+
+
+typedef struct _WgpModel WgpModel;
+
+
+WgpModel *
+wgp_model_new (void);
+
+void
+wgp_model_free (WgpModel *model);
+
+void
+wgp_model_clear (WgpModel *model);
+
+guint
+wgp_model_append (WgpModel *model, gpointer object);
+
+guint
+wgp_model_sort_appended (WgpModel *model);
+
+guint
+wgp_model_update (WgpModel *model, gpointer object);
+
+void
+wgp_model_truncate (WgpModel *model, guint n_rows);
+
+guint
+wgp_model_get_n_rows (WgpModel *model);
+
+guint
+wgp_model_get_length (WgpModel *model);
+
+guint
+wgp_model_get_row (WgpModel *model, guint position);
+
+gpointer
+wgp_model_get_object (WgpModel *model, guint row);
+
+const gchar *
+wgp_model_get_title (WgpModel *model, guint row);
+
+const gchar *
+wgp_model_get_url (WgpModel *model, guint row);
+
+gint
+wgp_model_get_duration (WgpModel *model, guint row);
+
+gint
+wgp_model_get_childcount (WgpModel *model, guint row);
+
+WgpModelType
+wgp_model_get_item_type (WgpModel *model, guint row);
+
+gboolean
+wgp_model_lookup (WgpModel *model, gpointer object, guint *row);
+
+void
+wgp_model_set_sort (WgpModel *model,
+                    WgpModelSort sort,
+                    gboolean descending);
+
+void
+wgp_model_set_filter (WgpModel *model, const gchar *text);
+
+WgpModelSort
+wgp_model_get_sort (WgpModel *model, gboolean *descending);
+
+const gchar *
+wgp_model_get_filter (WgpModel *model);
+
+
+#endif
@@ -0,0 +1,293 @@
+/*
+ * wgp-navigation.c: Navigation stack
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <grilo.h>
+#include "wgp-navigation.h"
+#include "wgp-trace.h"
+
+/*
+ * The sources and boxes opened from the root, each with its own breadcrumb.
+ * Opening or going back only adds or removes the breadcrumbs that changed,
+ * and then jQuery UI refreshes the button set.
+ *
+ * When a box is opened, the screen of the previous one (given by the caller)
+ * is kept in its entry, and handed back when the user goes back to it.
+ */
+
+typedef struct {
+        gpointer object;
+        gpointer screen;
+        WebKitDOMElement *input;
+        WebKitDOMElement *label;
+} Entry;
+
+struct _WgpNavigation {
+        WebKitWebView *web_view;
+        WebKitDOMDocument *document;
+        WebKitDOMNode *bar;
+        gchar *bar_id;
+        GDestroyNotify screen_free;
+
+        /* Index 0 is the root, without object */
+        GPtrArray *entries;
+};
+
+
+static void
+entry_free (WgpNavigation *navigation, Entry *entry)
+{
+        webkit_dom_node_remove_child (navigation->bar,
+                                      WEBKIT_DOM_NODE (entry->input),
+                                      NULL);
+        webkit_dom_node_remove_child (navigation->bar,
+                                      WEBKIT_DOM_NODE (entry->label),
+                                      NULL);
+
+        if (entry->screen) {
+                navigation->screen_free (entry->screen);
+        }
+        if (entry->object) {
+                g_object_unref (entry->object);
+        }
+        g_slice_free (Entry, entry);
+}
+
+static Entry *
+entry_new (WgpNavigation *navigation, gpointer object, const gchar *title)
+{
+        Entry *entry;
+        gchar *id;
+        gchar *index;
+
+        entry = g_slice_new0 (Entry);
+        entry->object = object ? g_object_ref (object) : NULL;
+
+        id = g_strdup_printf ("%s-%u", navigation->bar_id, navigation->entries->len);
+        index = g_strdup_printf ("%u", navigation->entries->len);
+
+        entry->input = webkit_dom_document_create_element (navigation->document,
+                                                           "input",
+                                                           NULL);
+        webkit_dom_element_set_attribute (entry->input, "type", "radio", NULL);
+        webkit_dom_element_set_attribute (entry->input,
+                                          "name",
+                                          navigation->bar_id,
+                                          NULL);
+        webkit_dom_element_set_attribute (entry->input, "id", id, NULL);
+
+        entry->label = webkit_dom_document_create_element (navigation->document,
+                                                           "label",
+                                                           NULL);
+        webkit_dom_element_set_attribute (entry->label, "for", id, NULL);
+        webkit_dom_element_set_attribute (entry->label, "data-index", index, NULL);
+        webkit_dom_node_set_text_content (WEBKIT_DOM_NODE (entry->label),
+                                          title,
+                                          NULL);
+
+        webkit_dom_node_append_child (navigation->bar,
+                                      WEBKIT_DOM_NODE (entry->input),
+                                      NULL);
+        webkit_dom_node_append_child (navigation->bar,
+                                      WEBKIT_DOM_NODE (entry->label),
+                                      NULL);
+
+        g_free (index);
+        g_free (id);
+
+        return entry;
+}
+
+static Entry *
+get_top (WgpNavigation *navigation)
+{
+        return g_ptr_array_index (navigation->entries,
+                                  navigation->entries->len - 1);
+}
+
+/* Checks the last breadcrumb and lets jQuery UI style the new ones */
+static void
+refresh_bar (WgpNavigation *navigation, const gchar *method)
+{
+        gchar *script;
+
+        webkit_dom_html_input_element_set_checked (
+                WEBKIT_DOM_HTML_INPUT_ELEMENT (get_top (navigation)->input),
+                TRUE);
+
+        script = g_strdup_printf ("$('#%s').buttonset(%s);",
+                                  navigation->bar_id,
+                                  method);
+        webkit_web_view_execute_script (navigation->web_view, script);
+        g_free (script);
+}
+
+
+/*
+ * Takes over the element @bar_id of the document in @web_view. The root
+ * breadcrumb, at depth 0, is labeled @root_title. @screen_free frees the
+ * screens given to wgp_navigation_push().
+ */
+WgpNavigation *
+wgp_navigation_new (WebKitWebView *web_view,
+                    const gchar *bar_id,
+                    const gchar *root_title,
+                    GDestroyNotify screen_free)
+{
+        WgpNavigation *navigation;
+
+        navigation = g_slice_new0 (WgpNavigation);
+        navigation->web_view = web_view;
+        navigation->document = webkit_web_view_get_dom_document (web_view);
+        navigation->bar = WEBKIT_DOM_NODE (
+                webkit_dom_document_get_element_by_id (navigation->document,
+                                                       bar_id));
+        navigation->bar_id = g_strdup (bar_id);
+        navigation->screen_free = screen_free;
+        navigation->entries = g_ptr_array_new ();
+
+        g_ptr_array_add (navigation->entries,
+                         entry_new (navigation, NULL, root_title));
+        refresh_bar (navigation, "");
+
+        return navigation;
+}
+
+void
+wgp_navigation_free (WgpNavigation *navigation)
+{
+        guint i;
+
+        for (i = 0; i < navigation->entries->len; i++) {
+                entry_free (navigation,
+                            g_ptr_array_index (navigation->entries, i));
+        }
+        g_ptr_array_free (navigation->entries, TRUE);
+        g_free (navigation->bar_id);
+        g_slice_free (WgpNavigation, navigation);
+}
+
+/*
+ * Opens @source_or_media on top of the current entry, which keeps @screen
+ * (NULL if there is nothing worth keeping) until the user goes back to it.
+ */
+void
+wgp_navigation_push (WgpNavigation *navigation,
+                     gpointer source_or_media,
+                     gpointer screen)
+{
+        Entry *top;
+        const gchar *title;
+        gint64 start;
+
+        start = wgp_trace_now ();
+
+        top = get_top (navigation);
+        if (top->screen) {
+                navigation->screen_free (top->screen);
+        }
+        top->screen = screen;
+
+        if (GRL_IS_MEDIA (source_or_media)) {
+                title = grl_media_get_title (GRL_MEDIA (source_or_media));
+        } else {
+                title = grl_metadata_source_get_name (
+                        GRL_METADATA_SOURCE (source_or_media));
+        }
+
+        g_ptr_array_add (navigation->entries,
+                         entry_new (navigation, source_or_media, title));
+        refresh_bar (navigation, "'refresh'");
+
+        wgp_trace_complete ("dom", "breadcrumbs", start,
+                            "\"depth\": %u", navigation->entries->len - 1);
+}
+
+/*
+ * Goes back to @depth, dropping the entries above it. Returns the screen kept
+ * for it, owned by the caller, or NULL.
+ */
+gpointer
+wgp_navigation_truncate (WgpNavigation *navigation, guint depth)
+{
+        Entry *top;
+        gpointer screen;
+        gint64 start;
+
+        if (depth >= navigation->entries->len) {
+                return NULL;
+        }
+
+        start = wgp_trace_now ();
+
+        while (navigation->entries->len > depth + 1) {
+                entry_free (navigation,
+                            g_ptr_array_remove_index (navigation->entries,
+                                                      navigation->entries->len - 1));
+        }
+
+        top = get_top (navigation);
+        screen = top->screen;
+        top->screen = NULL;
+        refresh_bar (navigation, "'refresh'");
+
+        wgp_trace_complete ("dom", "breadcrumbs", start,
+                            "\"depth\": %u", depth);
+
+        return screen;
+}
+
+/* Number of entries on top of the root */
+guint
+wgp_navigation_get_depth (WgpNavigation *navigation)
+{
+        return navigation->entries->len - 1;
+}
+
+/* Source or media opened at @depth, NULL for the root */
+gpointer
+wgp_navigation_get_object (WgpNavigation *navigation, guint depth)
+{
+        Entry *entry;
+
+        if (depth >= navigation->entries->len) {
+                return NULL;
+        }
+
+        entry = g_ptr_array_index (navigation->entries, depth);
+
+        return entry->object;
+}
+
+/* Replaces the object at @depth, like a placeholder once its source is loaded */
+void
+wgp_navigation_set_object (WgpNavigation *navigation,
+                           guint depth,
+                           gpointer source_or_media)
+{
+        Entry *entry;
+
+        if (depth == 0 || depth >= navigation->entries->len) {
+                return;
+        }
+
+        entry = g_ptr_array_index (navigation->entries, depth);
+        g_object_ref (source_or_media);
+        g_object_unref (entry->object);
+        entry->object = source_or_media;
+}
@@ -0,0 +1,58 @@
+/*
+ * wgp-navigation.h: Navigation stack
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_NAVIGATION_H__
+#define __WGP_NAVIGATION_H__
+
+#include <webkit/webkit.h>
+
+
+typedef struct _WgpNavigation WgpNavigation;
+
+
+WgpNavigation *
+wgp_navigation_new (WebKitWebView *web_view,
+                    const gchar *bar_id,
+                    const gchar *root_title,
+                    GDestroyNotify screen_free);
+
+void
+wgp_navigation_free (WgpNavigation *navigation);
+
+void
+wgp_navigation_push (WgpNavigation *navigation,
+                     gpointer source_or_media,
+                     gpointer screen);
+
+gpointer
+wgp_navigation_truncate (WgpNavigation *navigation, guint depth);
+
+guint
+wgp_navigation_get_depth (WgpNavigation *navigation);
+
+gpointer
+wgp_navigation_get_object (WgpNavigation *navigation, guint depth);
+
+void
+wgp_navigation_set_object (WgpNavigation *navigation,
+                           guint depth,
+                           gpointer source_or_media);
+
+
+#endif
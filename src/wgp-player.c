@@ -0,0 +1,1893 @@
+/*
+ * wgp-player.c: Player user interface
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <webkit/webkit.h>
+#include <grilo.h>
+#include "config.h"
+#include "wgp-player.h"
+#include "wgp-util.h"
+#include "wgp-listing.h"
+#include "wgp-cache.h"
+#include "wgp-view.h"
+#include "wgp-metadata.h"
+#include "wgp-thumbnail.h"
+#include "wgp-search.h"
+#include "wgp-loader.h"
+#include "wgp-trace.h"
+#include "wgp-index.h"
+#include "wgp-prefetch.h"
+#include "wgp-scheduler.h"
+#include "wgp-navigation.h"
+#include "wgp-session.h"
+#include "wgp-queue.h"
+#include "wgp-watchdog.h"
+
+/*
+ * The Grilo registry, the plugins and every cache below the player are shared
+ * by the whole process. Each window has its own WgpPlayer with what it shows,
+ * so several windows can be driven by the same engine, loading the plugins
+ * and browsing every container once.
+ */
+
+struct _WgpPlayer {
+        guint index;
+
+        WebKitDOMDocument *document;
+        WebKitDOMNode *sources_node;
+        WebKitDOMNode *main_node;
+        WebKitDOMNode *status_node;
+
+        GrlMediaSource *current_source;
+        GrlMedia *current_container;
+        WgpNavigation *navigation;
+
+        WgpListing *listing;
+        WgpView *current_view;
+        GrlMedia *pending_play;
+        WgpQueue *queue;
+        WgpSearch *current_search;
+        gboolean filter_status;
+
+        /* Sources from the last run shown until their plugins are loaded */
+        GHashTable *placeholders;
+        gchar *pending_source_id;
+        gboolean showing_sources;
+
+        /* Screen of the last run, shown until its source is loaded */
+        WgpSession *restoring;
+
+        gboolean load_plugins;
+        WgpPlayerReadyFunc ready_func;
+        gpointer ready_data;
+        WgpPlayerBrowseFunc browse_func;
+        gpointer browse_data;
+
+        /* Bumped on every navigation, results from older ones are dropped */
+        guint browse_generation;
+        GList *browse_pages;
+};
+
+static GrlPluginRegistry *registry = NULL;
+static GList *players = NULL;
+static gboolean plugins_loading = FALSE;
+static gboolean plugins_loaded = FALSE;
+
+static gint64 start_time = 0;
+static gboolean first_source_shown = FALSE;
+
+static guint batch_size = WGP_LISTING_DEFAULT_BATCH_SIZE;
+static guint flush_interval = WGP_LISTING_DEFAULT_FLUSH_INTERVAL;
+static guint search_deadline = WGP_SEARCH_DEFAULT_DEADLINE;
+
+/* Results of a browse operation, kept to store them in the cache */
+typedef struct {
+        WgpPlayer *player;
+        GrlMediaSource *source;
+        GrlMedia *container;
+        WgpOperation *operation;
+        guint generation;
+        guint64 trace_id;
+
+        gchar *key;
+        guint offset;
+        guint count;
+        GPtrArray *items;
+
+        /* Cached results being shown, if the page is being revalidated */
+        GPtrArray *cached;
+} BrowsePage;
+
+/* Row waiting for its thumbnail */
+typedef struct {
+        WgpPlayer *player;
+        GrlMedia *media;
+} ThumbnailRequest;
+
+
+static void
+browse_source_cb (GrlMediaSource *source,
+                  guint browse_id,
+                  GrlMedia *media,
+                  guint remaining,
+                  gpointer user_data,
+                  const GError *error);
+
+static void
+media_clicked_cb (WgpPlayer *player, GrlMedia *media);
+
+static void
+source_clicked_cb (WgpPlayer *player, GrlMetadataSource *source);
+
+static void
+source_added_cb (GrlPluginRegistry *registry,
+                 GrlMediaPlugin *source,
+                 gpointer user_data);
+
+static void
+play_resolved_cb (GrlMedia *media, gpointer user_data);
+
+static void
+metadata_resolved_cb (GrlMedia *media, gpointer user_data);
+
+
+/* Startup times are counted from here, the first player is used otherwise */
+void
+wgp_player_startup_begin (void)
+{
+        start_time = g_get_monotonic_time ();
+}
+
+void
+wgp_player_startup_mark (const gchar *what)
+{
+        g_debug ("Startup: %s after %.1f ms",
+                 what,
+                 (g_get_monotonic_time () - start_time) / 1000.0);
+}
+
+
+/* Shown over the listing until the next navigation, NULL to hide it */
+static void
+set_status (WgpPlayer *player, const gchar *text)
+{
+        webkit_dom_node_set_text_content (player->status_node, text ? text : "", NULL);
+}
+
+
+/* What was shown in a box, kept to go back to it */
+typedef struct {
+        WgpView *view;
+        WgpListingState *listing;
+} Screen;
+
+
+static void
+screen_free (Screen *screen)
+{
+        wgp_listing_state_free (screen->listing);
+        wgp_view_free (screen->view);
+        g_slice_free (Screen, screen);
+}
+
+
+/* The media clicked is not played once resolved */
+static void
+clear_pending_play (WgpPlayer *player)
+{
+        if (player->pending_play) {
+                wgp_metadata_release (player->pending_play,
+                                      play_resolved_cb,
+                                      player);
+                g_object_unref (player->pending_play);
+                player->pending_play = NULL;
+        }
+}
+
+
+/* Stops everything still going on for the current screen */
+static void
+stop_view (WgpPlayer *player)
+{
+        BrowsePage *page;
+        GList *l;
+
+        player->browse_generation++;
+
+        if (player->current_search) {
+                wgp_search_free (player->current_search);
+                player->current_search = NULL;
+        }
+
+        for (l = player->browse_pages; l; l = l->next) {
+                page = l->data;
+                g_debug ("Cancelling browse operation: %u", page->offset);
+                wgp_scheduler_cancel (page->operation);
+        }
+        g_list_free (player->browse_pages);
+        player->browse_pages = NULL;
+        wgp_prefetch_cancel (player);
+        wgp_queue_stop (player->queue);
+        clear_pending_play (player);
+        wgp_metadata_cancel_all (metadata_resolved_cb, player);
+
+        player->showing_sources = FALSE;
+        g_free (player->pending_source_id);
+        player->pending_source_id = NULL;
+        if (player->restoring) {
+                wgp_session_free (player->restoring);
+                player->restoring = NULL;
+        }
+
+        set_status (player, NULL);
+        player->filter_status = FALSE;
+}
+
+
+static void
+clear_view (WgpPlayer *player)
+{
+        stop_view (player);
+        wgp_listing_clear (player->listing);
+        wgp_view_free (player->current_view);
+        player->current_view = wgp_view_new ();
+}
+
+
+/* Like clear_view(), but the screen is kept for wgp_navigation_push() */
+static Screen *
+save_view (WgpPlayer *player)
+{
+        Screen *screen;
+
+        stop_view (player);
+
+        screen = g_slice_new (Screen);
+        screen->view = player->current_view;
+        screen->listing = wgp_listing_save (player->listing);
+        player->current_view = wgp_view_new ();
+
+        return screen;
+}
+
+
+static void
+show_item (WgpPlayer *player, gpointer source_or_media)
+{
+        wgp_listing_append (player->listing,
+                            wgp_view_add_object (player->current_view, source_or_media));
+}
+
+
+static void
+show_placeholder (gpointer key, gpointer value, gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+
+        show_item (player, value);
+}
+
+
+static void
+plugins_clicked_cb (WgpPlayer *player)
+{
+        GList *sources;
+        GList *l;
+
+        wgp_util_remove_all_children (player->main_node);
+        clear_view (player);
+
+        webkit_dom_node_set_text_content (
+                player->main_node,
+                "Grilo plugins",
+                NULL);
+
+        wgp_navigation_truncate (player->navigation, 0);
+        player->showing_sources = TRUE;
+
+        /* Sources whose plugins are still loading */
+        g_hash_table_foreach (player->placeholders, show_placeholder, player);
+
+        sources = grl_plugin_registry_get_sources (registry, FALSE);
+
+        for (l = sources; l; l = l->next) {
+                source_added_cb (registry, GRL_MEDIA_PLUGIN (l->data), player);
+        }
+        g_list_free (sources);
+}
+
+
+static GrlMediaSource *
+get_media_source (WgpPlayer *player, GrlMedia *media)
+{
+        GrlMediaPlugin *source = NULL;
+
+        if (grl_media_get_source (media)) {
+                source = grl_plugin_registry_lookup_source (
+                        registry,
+                        grl_media_get_source (media));
+        }
+
+        return source ? GRL_MEDIA_SOURCE (source) : player->current_source;
+}
+
+
+static GrlMediaSource *
+get_queue_source (GrlMedia *media, gpointer user_data)
+{
+        return get_media_source (user_data, media);
+}
+
+
+static void
+play_media (WgpPlayer *player, GrlMedia *media)
+{
+        WebKitDOMElement *element = NULL;
+        const gchar *url;
+
+        g_debug ("Play media: %s", grl_media_get_title (media));
+        url = grl_media_get_url (media);
+
+        if (url == NULL) {
+                webkit_dom_node_set_text_content (
+                        player->main_node,
+                        wgp_view_strdup_printf (player->current_view,
+                                                "Could not play: %s",
+                                                grl_media_get_title (media)),
+                        NULL);
+                return;
+        }
+
+        /* Audio and video are played by the queue */
+        if (GRL_IS_MEDIA_IMAGE (media)) {
+                element = webkit_dom_document_create_element (player->document, "img", NULL);
+        }
+
+        if (element != NULL) {
+                webkit_dom_node_append_child (
+                        player->main_node,
+                        WEBKIT_DOM_NODE (webkit_dom_document_create_element (player->document, "br", NULL)),
+                        NULL);
+
+                webkit_dom_element_set_attribute (element, "src", url, NULL);
+                webkit_dom_node_append_child (player->main_node,
+                                              WEBKIT_DOM_NODE (element),
+                                              NULL);
+        } else {
+                g_warning ("Unknown media type: %s", grl_media_get_title (media));
+        }
+}
+
+
+static void
+play_resolved_cb (GrlMedia *media, gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+
+        /* Only if the user did not click anything else meanwhile */
+        if (media == player->pending_play) {
+                play_media (player, media);
+                clear_pending_play (player);
+        }
+}
+
+
+/* Plays @media and then the items after it in the listing */
+static void
+play_queue (WgpPlayer *player, GrlMedia *media)
+{
+        GPtrArray *items;
+        gpointer object;
+        guint length;
+        guint start;
+        guint i;
+
+        length = wgp_listing_get_length (player->listing);
+        for (start = 0; start < length; start++) {
+                if (wgp_listing_get_item (player->listing, start) == (gpointer) media) {
+                        break;
+                }
+        }
+
+        items = g_ptr_array_new_with_free_func (g_object_unref);
+        g_ptr_array_add (items, g_object_ref (media));
+        for (i = start + 1;
+             i < length && items->len < WGP_QUEUE_MAX_ITEMS;
+             i++) {
+                object = wgp_listing_get_item (player->listing, i);
+                if (GRL_IS_MEDIA (object) && wgp_queue_can_play (GRL_MEDIA (object))) {
+                        g_ptr_array_add (items, g_object_ref (object));
+                }
+        }
+
+        wgp_util_remove_all_children (player->main_node);
+        wgp_queue_play (player->queue, items, 0);
+        g_ptr_array_unref (items);
+}
+
+
+static void
+media_clicked_cb (WgpPlayer *player, GrlMedia *media)
+{
+        const gchar *title;
+
+        title = grl_media_get_title (media);
+        g_debug ("Media clicked: '%s'", title);
+
+        clear_pending_play (player);
+        wgp_queue_stop (player->queue);
+        wgp_util_remove_all_children (player->main_node);
+        webkit_dom_node_set_text_content (
+                player->main_node,
+                wgp_view_strdup_printf (player->current_view, "Media selected: %s", title),
+                NULL);
+
+        if (GRL_IS_MEDIA_BOX (media)) {
+                g_debug ("Browsing media: %s", title);
+                player->current_source = get_media_source (player, media);
+                g_object_ref (media);
+                if (player->current_container) {
+                        g_object_unref (player->current_container);
+                }
+                player->current_container = media;
+
+                /* Search results are not kept, the root is always rebuilt */
+                if (wgp_navigation_get_depth (player->navigation) > 0) {
+                        wgp_navigation_push (player->navigation, media, save_view (player));
+                } else {
+                        clear_view (player);
+                        wgp_navigation_push (player->navigation, media, NULL);
+                }
+                wgp_listing_start_paging (player->listing);
+        } else if (wgp_queue_can_play (media)) {
+                play_queue (player, media);
+        } else if (grl_media_get_url (media) ||
+                   wgp_metadata_is_resolved (media)) {
+                play_media (player, media);
+        } else {
+                player->pending_play = g_object_ref (media);
+                wgp_metadata_resolve (WGP_SCHEDULER_INTERACTIVE,
+                                      get_media_source (player, media),
+                                      media,
+                                      play_resolved_cb,
+                                      player);
+        }
+}
+
+
+static BrowsePage *
+browse_page_new (WgpPlayer *player,
+                 const gchar *key,
+                 guint offset,
+                 guint count,
+                 GPtrArray *cached)
+{
+        BrowsePage *page;
+
+        page = g_slice_new0 (BrowsePage);
+        page->player = player;
+        page->source = g_object_ref (player->current_source);
+        page->container = player->current_container ?
+                g_object_ref (player->current_container) : NULL;
+        page->generation = player->browse_generation;
+        page->key = g_strdup (key);
+        page->offset = offset;
+        page->count = count;
+        page->items = g_ptr_array_new_with_free_func (g_object_unref);
+        page->cached = cached ? g_ptr_array_ref (cached) : NULL;
+        page->trace_id = wgp_trace_new_id ();
+
+        wgp_trace_begin ("browse", "browse", page->trace_id,
+                         "\"source\": \"%s\", \"offset\": %u, \"revalidate\": %s",
+                         wgp_trace_escape (grl_metadata_source_get_id (
+                                                   GRL_METADATA_SOURCE (player->current_source))),
+                         offset,
+                         cached ? "true" : "false");
+
+        return page;
+}
+
+
+static void
+browse_page_free (BrowsePage *page)
+{
+        g_object_unref (page->source);
+        if (page->container) {
+                g_object_unref (page->container);
+        }
+        g_free (page->key);
+        g_ptr_array_unref (page->items);
+        if (page->cached) {
+                g_ptr_array_unref (page->cached);
+        }
+        g_slice_free (BrowsePage, page);
+}
+
+
+/* Number of items at the start of both pages with the same ids */
+static guint
+browse_page_common (GPtrArray *a, GPtrArray *b)
+{
+        guint i;
+
+        for (i = 0; i < a->len && i < b->len; i++) {
+                if (g_strcmp0 (grl_media_get_id (g_ptr_array_index (a, i)),
+                               grl_media_get_id (g_ptr_array_index (b, i))) != 0) {
+                        break;
+                }
+        }
+
+        return i;
+}
+
+
+static gboolean
+browse_page_equal (GPtrArray *a, GPtrArray *b)
+{
+        return a->len == b->len && browse_page_common (a, b) == a->len;
+}
+
+
+static void
+browse_page_append (WgpPlayer *player, GPtrArray *items)
+{
+        guint i;
+
+        for (i = 0; i < items->len; i++) {
+                show_item (player, g_ptr_array_index (items, i));
+        }
+        wgp_listing_end_page (player->listing);
+}
+
+
+/* The rows shown before the first one that changed are kept */
+static void
+revalidate_page (BrowsePage *page)
+{
+        WgpPlayer *player = page->player;
+        gchar *current_key;
+        guint kept;
+        guint i;
+
+        if (browse_page_equal (page->cached, page->items)) {
+                return;
+        }
+
+        /* Only refresh the view if it still shows this page as the last one */
+        current_key = wgp_cache_make_key (player->current_source,
+                                          player->current_container,
+                                          page->offset,
+                                          wgp_metadata_get_fast_keys ());
+        if (g_strcmp0 (current_key, page->key) == 0 &&
+            wgp_listing_get_length (player->listing) <= page->offset + page->count) {
+                kept = browse_page_common (page->cached, page->items);
+                g_debug ("Cached page changed from row %u, refreshing: %s",
+                         page->offset + kept, page->key);
+                wgp_listing_truncate (player->listing,
+                                      page->offset,
+                                      page->offset + kept);
+                for (i = kept; i < page->items->len; i++) {
+                        show_item (player, g_ptr_array_index (page->items, i));
+                }
+                wgp_listing_end_page (player->listing);
+        }
+        g_free (current_key);
+}
+
+
+/* Rows looked at for containers to prefetch */
+#define PREFETCH_SCAN_ROWS 50
+
+/*
+ * Going back is served by the navigation, so the candidates are the first
+ * boxes shown. Boxes known to have children go before the ones with an
+ * unknown count, and empty ones are skipped.
+ */
+static void
+prefetch_next_containers (WgpPlayer *player)
+{
+        GrlMedia *media;
+        GList *unknown = NULL;
+        GList *l;
+        guint length;
+        guint i;
+        gint childcount;
+
+        if (player->showing_sources || player->current_source == NULL) {
+                return;
+        }
+
+        length = MIN (wgp_listing_get_length (player->listing), PREFETCH_SCAN_ROWS);
+        for (i = 0; i < length; i++) {
+                media = wgp_listing_get_item (player->listing, i);
+                if (!GRL_IS_MEDIA_BOX (media)) {
+                        continue;
+                }
+
+                childcount = grl_media_box_get_childcount (GRL_MEDIA_BOX (media));
+                if (childcount > 0) {
+                        wgp_prefetch_add (player,
+                                          get_media_source (player, media),
+                                          media);
+                } else if (childcount == GRL_METADATA_KEY_CHILDCOUNT_UNKNOWN) {
+                        unknown = g_list_prepend (unknown, media);
+                }
+        }
+
+        unknown = g_list_reverse (unknown);
+        for (l = unknown; l; l = l->next) {
+                wgp_prefetch_add (player,
+                                  get_media_source (player, l->data),
+                                  l->data);
+        }
+        g_list_free (unknown);
+
+        wgp_prefetch_start ();
+}
+
+
+/* Restored screens are revalidated at once, but kept in pages of the usual size */
+static void
+store_page (GrlMediaSource *source, BrowsePage *page)
+{
+        const gchar *source_id;
+        const gchar *container_id;
+        GPtrArray *items;
+        gchar *key;
+        guint start;
+        guint i;
+
+        source_id = grl_metadata_source_get_id (GRL_METADATA_SOURCE (source));
+        container_id = page->container ? grl_media_get_id (page->container) : NULL;
+
+        if (page->items->len <= WGP_LISTING_PAGE_SIZE) {
+                wgp_cache_insert (page->key, source_id, page->items);
+                wgp_index_store (source_id, container_id, page->offset, page->items);
+                return;
+        }
+
+        for (start = 0; start < page->items->len; start += WGP_LISTING_PAGE_SIZE) {
+                items = g_ptr_array_new_with_free_func (g_object_unref);
+                for (i = start;
+                     i < MIN (start + WGP_LISTING_PAGE_SIZE, page->items->len);
+                     i++) {
+                        g_ptr_array_add (items,
+                                         g_object_ref (g_ptr_array_index (page->items, i)));
+                }
+
+                key = wgp_cache_make_key (source,
+                                          page->container,
+                                          page->offset + start,
+                                          wgp_metadata_get_fast_keys ());
+                wgp_cache_insert (key, source_id, items);
+                wgp_index_store (source_id, container_id, page->offset + start, items);
+
+                g_free (key);
+                g_ptr_array_unref (items);
+        }
+}
+
+
+static void
+show_browse_error (BrowsePage *page, const GError *error)
+{
+        WgpPlayer *player = page->player;
+
+        if (page->cached) {
+                set_status (player,
+                            wgp_view_strdup_printf (player->current_view,
+                                                    "Showing saved results. %s",
+                                                    error->message));
+        } else if (page->items->len > 0 || page->offset > 0) {
+                set_status (player,
+                            wgp_view_strdup_printf (player->current_view,
+                                                    "Partial results. %s. "
+                                                    "Scroll down or click here "
+                                                    "to retry.",
+                                                    error->message));
+        } else {
+                set_status (player,
+                            wgp_view_strdup_printf (player->current_view,
+                                                    "%s. Click here to retry.",
+                                                    error->message));
+        }
+}
+
+
+static void
+browse_source_cb (GrlMediaSource *source,
+                  guint browse_id,
+                  GrlMedia *media,
+                  guint remaining,
+                  gpointer user_data,
+                  const GError *error)
+{
+        BrowsePage *page = user_data;
+        WgpPlayer *player = page->player;
+
+        if (page->generation != player->browse_generation) {
+                if (media) {
+                        g_object_unref (media);
+                }
+                if (remaining == 0) {
+                        wgp_trace_end ("browse", "browse", page->trace_id,
+                                       "\"count\": %u, \"cancelled\": true",
+                                       page->items->len);
+                        browse_page_free (page);
+                }
+                return;
+        }
+
+        if (error) {
+                g_warning ("Browse operation failed in '%s'. Reason: %s",
+                           grl_metadata_source_get_name (GRL_METADATA_SOURCE (source)),
+                           error->message);
+        }
+
+        if (media) {
+                g_ptr_array_add (page->items, media);
+                if (page->items->len == 1) {
+                        wgp_trace_mark ("browse", "first result",
+                                        page->trace_id, NULL);
+                }
+                if (page->cached == NULL) {
+                        show_item (player, media);
+                }
+        }
+
+        if (remaining == 0) {
+                wgp_trace_end ("browse", "browse", page->trace_id,
+                               "\"count\": %u, \"cancelled\": false, "
+                               "\"failed\": %s",
+                               page->items->len,
+                               error ? "true" : "false");
+
+                if (page->cached) {
+                        if (error == NULL) {
+                                revalidate_page (page);
+                        }
+                } else if (error) {
+                        /* Fetched again on the next scroll, not complete */
+                        wgp_listing_fail_page (player->listing);
+                } else {
+                        wgp_listing_end_page (player->listing);
+                        g_debug ("Browse operation finished! %u items in %u DOM commits",
+                                 wgp_listing_get_length (player->listing),
+                                 wgp_listing_get_commits (player->listing));
+                }
+
+                /* Incomplete pages are shown but never kept */
+                if (error) {
+                        show_browse_error (page, error);
+                } else {
+                        store_page (source, page);
+                        if (page->offset == 0) {
+                                prefetch_next_containers (player);
+                        }
+                }
+                player->browse_pages = g_list_remove (player->browse_pages, page);
+                browse_page_free (page);
+        } else {
+                g_debug ("%d results remaining!", remaining);
+        }
+
+        if (player->browse_func) {
+                player->browse_func (media, remaining, player->browse_data);
+        }
+}
+
+
+static void
+fetch_page_cb (WgpListing *listing,
+               guint offset,
+               guint count,
+               gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+        BrowsePage *page;
+        GPtrArray *cached;
+        gboolean stale = FALSE;
+        gchar *key;
+
+        key = wgp_cache_make_key (player->current_source,
+                                  player->current_container,
+                                  offset,
+                                  wgp_metadata_get_fast_keys ());
+
+        cached = wgp_cache_lookup (key, &stale);
+        if (cached) {
+                g_debug ("Page served from cache: %u-%u%s",
+                         offset, offset + count, stale ? " (stale)" : "");
+                browse_page_append (player, cached);
+                if (offset == 0 && !stale) {
+                        prefetch_next_containers (player);
+                }
+        } else {
+                /* Left by a previous run, always refreshed */
+                cached = wgp_index_lookup (
+                        grl_metadata_source_get_id (
+                                GRL_METADATA_SOURCE (player->current_source)),
+                        player->current_container ?
+                        grl_media_get_id (player->current_container) : NULL,
+                        offset);
+                if (cached) {
+                        g_debug ("Page served from index: %u-%u",
+                                 offset, offset + count);
+                        stale = TRUE;
+                        browse_page_append (player, cached);
+                }
+        }
+
+        if (cached == NULL && offset > 0 &&
+            wgp_scheduler_is_degraded (player->current_source)) {
+                /* Failed again at once, until the source is back */
+                set_status (player,
+                            wgp_view_strdup_printf (
+                                    player->current_view,
+                                    "Partial results. %s is not responding, "
+                                    "scroll down or click here to retry later.",
+                                    grl_metadata_source_get_name (
+                                            GRL_METADATA_SOURCE (player->current_source))));
+                wgp_listing_fail_page (listing);
+        } else if (cached == NULL || stale) {
+                page = browse_page_new (player, key, offset, count, cached);
+
+                /* The prefetch of this container may still be running */
+                if (offset == 0) {
+                        page->operation = wgp_prefetch_take (player,
+                                                             key,
+                                                             browse_source_cb,
+                                                             page);
+                }
+
+                if (page->operation == NULL) {
+                        g_debug ("Browsing page: %u-%u", offset, offset + count);
+                        /* Revalidations can wait for what the user is waiting for */
+                        page->operation = wgp_scheduler_browse (
+                                stale ? WGP_SCHEDULER_BACKGROUND : WGP_SCHEDULER_INTERACTIVE,
+                                player->current_source,
+                                player->current_container,
+                                wgp_metadata_get_fast_keys (),
+                                offset, count,
+                                GRL_RESOLVE_FAST_ONLY,
+                                browse_source_cb,
+                                page);
+                }
+                player->browse_pages = g_list_prepend (player->browse_pages, page);
+        }
+
+        if (offset == 0) {
+                wgp_prefetch_note_fetch (player, key);
+        }
+
+        if (cached) {
+                g_ptr_array_unref (cached);
+        }
+        g_free (key);
+}
+
+
+static gboolean
+is_placeholder (gpointer object)
+{
+        return g_object_get_data (G_OBJECT (object), "wgp-placeholder") != NULL;
+}
+
+
+static void
+open_placeholder (WgpPlayer *player, GrlMedia *placeholder)
+{
+        GrlMediaPlugin *source;
+
+        source = grl_plugin_registry_lookup_source (registry,
+                                                    grl_media_get_id (placeholder));
+        if (source) {
+                source_clicked_cb (player, GRL_METADATA_SOURCE (source));
+        } else if (!plugins_loaded) {
+                /* Opened as soon as its plugin is loaded */
+                g_free (player->pending_source_id);
+                player->pending_source_id = g_strdup (grl_media_get_id (placeholder));
+                webkit_dom_node_set_text_content (
+                        player->main_node,
+                        wgp_view_strdup_printf (player->current_view,
+                                                "Loading source: %s",
+                                                grl_media_get_title (placeholder)),
+                        NULL);
+        }
+}
+
+
+static void
+open_item (WgpPlayer *player, gpointer source_or_media)
+{
+        /* Restored items can not be opened without their source */
+        if (player->restoring) {
+                set_status (player,
+                            wgp_view_strdup_printf (player->current_view,
+                                                    "Loading source: %s",
+                                                    player->restoring->source_name));
+                return;
+        }
+
+        /* The view releases its items when it is replaced */
+        g_object_ref (source_or_media);
+
+        if (is_placeholder (source_or_media)) {
+                open_placeholder (player, GRL_MEDIA (source_or_media));
+        } else if (GRL_IS_MEDIA (source_or_media)) {
+                media_clicked_cb (player, GRL_MEDIA (source_or_media));
+        } else {
+                source_clicked_cb (player, GRL_METADATA_SOURCE (source_or_media));
+        }
+
+        g_object_unref (source_or_media);
+}
+
+
+static const gchar *
+get_thumbnail_source (GrlMedia *media)
+{
+        if (grl_media_get_thumbnail (media)) {
+                return grl_media_get_thumbnail (media);
+        }
+
+        if (GRL_IS_MEDIA_IMAGE (media)) {
+                return grl_media_get_url (media);
+        }
+
+        return NULL;
+}
+
+
+static void
+set_row_thumbnail (WebKitDOMElement *row, const gchar *thumbnail_uri)
+{
+        gchar *style;
+
+        style = g_strdup_printf ("background-image: url('%s');", thumbnail_uri);
+        webkit_dom_element_set_attribute (row, "style", style, NULL);
+        g_free (style);
+}
+
+
+static void
+thumbnail_ready_cb (const gchar *uri,
+                    const gchar *thumbnail_uri,
+                    gpointer user_data)
+{
+        ThumbnailRequest *request = user_data;
+        WebKitDOMElement *row;
+
+        row = wgp_listing_get_row (request->player->listing, request->media);
+        if (row && thumbnail_uri) {
+                set_row_thumbnail (row, thumbnail_uri);
+        }
+
+        g_object_unref (request->media);
+        g_slice_free (ThumbnailRequest, request);
+}
+
+
+static void
+show_thumbnail (WgpPlayer *player, GrlMedia *media, WebKitDOMElement *row)
+{
+        ThumbnailRequest *request;
+        const gchar *uri;
+        const gchar *thumbnail_uri;
+
+        uri = get_thumbnail_source (media);
+        if (uri == NULL) {
+                return;
+        }
+
+        thumbnail_uri = wgp_thumbnail_lookup (uri);
+        if (thumbnail_uri && row) {
+                set_row_thumbnail (row, thumbnail_uri);
+        } else if (thumbnail_uri == NULL) {
+                request = g_slice_new (ThumbnailRequest);
+                request->player = player;
+                request->media = g_object_ref (media);
+                wgp_thumbnail_request (uri, thumbnail_ready_cb, request);
+        }
+}
+
+
+static void
+metadata_resolved_cb (GrlMedia *media, gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+
+        wgp_listing_refresh (player->listing, media);
+        show_thumbnail (player, media, wgp_listing_get_row (player->listing, media));
+}
+
+
+static void
+row_shown_cb (WgpListing *listing,
+              gpointer object,
+              WebKitDOMElement *row,
+              gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+
+        if (!GRL_IS_MEDIA (object)) {
+                if (wgp_scheduler_is_degraded (GRL_MEDIA_SOURCE (object))) {
+                        webkit_dom_element_set_attribute (row,
+                                                          "class",
+                                                          "ui-widget-content degraded",
+                                                          NULL);
+                }
+                return;
+        }
+
+        if (is_placeholder (object)) {
+                return;
+        }
+
+        /* Restored items come with their thumbnails */
+        if (player->restoring || wgp_metadata_is_resolved (GRL_MEDIA (object))) {
+                show_thumbnail (player, GRL_MEDIA (object), row);
+        } else {
+                wgp_metadata_resolve (WGP_SCHEDULER_VISIBLE,
+                                      get_media_source (player, GRL_MEDIA (object)),
+                                      GRL_MEDIA (object),
+                                      metadata_resolved_cb,
+                                      player);
+        }
+}
+
+
+/* Scrolled out of view, its metadata is not urgent any more */
+static void
+row_hidden_cb (WgpListing *listing,
+               gpointer object,
+               WebKitDOMElement *row,
+               gpointer user_data)
+{
+        wgp_metadata_release (object, metadata_resolved_cb, user_data);
+}
+
+
+static void
+item_activated_cb (WgpListing *listing,
+                   gpointer object,
+                   gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+
+        open_item (player, object);
+}
+
+
+/* Shows again the source or box at @depth, as it was left if it was kept */
+static void
+go_back (WgpPlayer *player, guint depth)
+{
+        gpointer object;
+        Screen *screen;
+
+        object = wgp_navigation_get_object (player->navigation, depth);
+        if (object == NULL) {
+                return;
+        }
+
+        if (player->restoring) {
+                set_status (player,
+                            wgp_view_strdup_printf (player->current_view,
+                                                    "Loading source: %s",
+                                                    player->restoring->source_name));
+                return;
+        }
+
+        clear_view (player);
+        screen = wgp_navigation_truncate (player->navigation, depth);
+
+        if (player->current_container) {
+                g_object_unref (player->current_container);
+                player->current_container = NULL;
+        }
+        if (GRL_IS_MEDIA (object)) {
+                player->current_source = get_media_source (player, GRL_MEDIA (object));
+                player->current_container = g_object_ref (object);
+        } else {
+                player->current_source = GRL_MEDIA_SOURCE (object);
+        }
+
+        if (screen) {
+                g_debug ("Screen restored at depth %u", depth);
+                wgp_view_free (player->current_view);
+                player->current_view = screen->view;
+                wgp_listing_restore (player->listing, screen->listing);
+                g_slice_free (Screen, screen);
+        } else {
+                wgp_listing_start_paging (player->listing);
+        }
+}
+
+
+/* The status offers to fetch again the page that failed */
+static void
+status_clicked_cb (WebKitDOMEventTarget* target,
+                   WebKitDOMEvent* event,
+                   gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+
+        if (wgp_listing_is_failed (player->listing)) {
+                wgp_watchdog_enter (G_STRFUNC);
+                set_status (player, NULL);
+                wgp_listing_retry (player->listing);
+                wgp_watchdog_leave ();
+        }
+}
+
+
+/* Single handler for the clicks on every breadcrumb */
+static void
+breadcrumbs_clicked_cb (WebKitDOMEventTarget* target,
+                        WebKitDOMEvent* event,
+                        gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+        guint index;
+
+        if (!wgp_util_get_event_index (event, WEBKIT_DOM_NODE (target), &index)) {
+                return;
+        }
+
+        wgp_watchdog_enter (G_STRFUNC);
+        if (index == 0) {
+                plugins_clicked_cb (player);
+        } else {
+                go_back (player, index);
+        }
+        wgp_watchdog_leave ();
+}
+
+
+static void
+source_clicked_cb (WgpPlayer *player, GrlMetadataSource *source)
+{
+        const gchar *source_name;
+
+        source_name = grl_metadata_source_get_name (source);
+        g_debug ("Source clicked: '%s'", source_name);
+
+        /* The text goes in the new view, clearing frees the old one */
+        clear_view (player);
+        webkit_dom_node_set_text_content (
+                WEBKIT_DOM_NODE (player->main_node),
+                wgp_view_strdup_printf (player->current_view,
+                                        "Source selected: %s",
+                                        source_name),
+                NULL);
+
+        if (grl_metadata_source_supported_operations (source) & GRL_OP_BROWSE) {
+                g_debug ("Browsing source: %s", source_name);
+                player->current_source = GRL_MEDIA_SOURCE (source);
+                if (player->current_container) {
+                        g_object_unref (player->current_container);
+                        player->current_container = NULL;
+                }
+
+                wgp_navigation_truncate (player->navigation, 0);
+                wgp_navigation_push (player->navigation, source, NULL);
+                wgp_listing_start_paging (player->listing);
+        }
+}
+
+
+static void
+search_result_cb (WgpSearch *search,
+                  GrlMedia *media,
+                  gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+
+        show_item (player, media);
+}
+
+
+static void
+search_done_cb (WgpSearch *search,
+                gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+
+        webkit_dom_node_set_text_content (
+                player->main_node,
+                wgp_view_strdup_printf (player->current_view,
+                                        "Search finished: %u results",
+                                        wgp_search_get_results (search)),
+                NULL);
+}
+
+
+static void
+search_changed_cb (WebKitDOMEventTarget* target,
+                   WebKitDOMEvent* event,
+                   gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+        gchar *text;
+
+        text = webkit_dom_html_input_element_get_value (
+                WEBKIT_DOM_HTML_INPUT_ELEMENT (target));
+        g_strstrip (text);
+
+        wgp_watchdog_enter (G_STRFUNC);
+        if (*text != '\0') {
+                g_debug ("Search: '%s'", text);
+
+                wgp_navigation_truncate (player->navigation, 0);
+                clear_view (player);
+
+                wgp_util_remove_all_children (player->main_node);
+                webkit_dom_node_set_text_content (
+                        player->main_node,
+                        wgp_view_strdup_printf (player->current_view,
+                                                "Searching: %s",
+                                                text),
+                        NULL);
+
+                player->current_search = wgp_search_new (registry,
+                                                         text,
+                                                         search_deadline,
+                                                         search_result_cb,
+                                                         search_done_cb,
+                                                         player);
+        }
+        wgp_watchdog_leave ();
+
+        g_free (text);
+}
+
+
+/* Filtering and sorting only touch the items already listed */
+static void
+filter_changed_cb (WebKitDOMEventTarget* target,
+                   WebKitDOMEvent* event,
+                   gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+        gchar *text;
+
+        text = webkit_dom_html_input_element_get_value (
+                WEBKIT_DOM_HTML_INPUT_ELEMENT (target));
+        g_strstrip (text);
+
+        wgp_watchdog_enter (G_STRFUNC);
+        wgp_listing_set_filter (player->listing, text);
+        wgp_watchdog_leave ();
+
+        /* Paging stops while filtering, tell how much was loaded */
+        if (*text && !wgp_listing_is_complete (player->listing)) {
+                set_status (player,
+                            wgp_view_strdup_printf (
+                                    player->current_view,
+                                    "%u of %u loaded, clear the filter to load more",
+                                    wgp_listing_get_length (player->listing),
+                                    wgp_listing_get_n_appended (player->listing)));
+                player->filter_status = TRUE;
+        } else if (player->filter_status) {
+                set_status (player, NULL);
+                player->filter_status = FALSE;
+        }
+
+        g_free (text);
+}
+
+
+static void
+sort_changed_cb (WebKitDOMEventTarget* target,
+                 WebKitDOMEvent* event,
+                 gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+        WgpModelSort sort = WGP_MODEL_SORT_NONE;
+        gchar *value;
+
+        value = webkit_dom_html_select_element_get_value (
+                WEBKIT_DOM_HTML_SELECT_ELEMENT (target));
+
+        if (g_str_has_prefix (value, "title")) {
+                sort = WGP_MODEL_SORT_TITLE;
+        } else if (g_str_has_prefix (value, "duration")) {
+                sort = WGP_MODEL_SORT_DURATION;
+        } else if (g_str_has_prefix (value, "type")) {
+                sort = WGP_MODEL_SORT_TYPE;
+        }
+
+        wgp_watchdog_enter (G_STRFUNC);
+        wgp_listing_set_sort (player->listing,
+                              sort,
+                              g_str_has_suffix (value, "-desc"));
+        wgp_watchdog_leave ();
+
+        g_free (value);
+}
+
+
+/* The restored screen is checked against its source like a stale page */
+static void
+revalidate_session (WgpPlayer *player, GrlMediaSource *source)
+{
+        WgpSession *session = player->restoring;
+        BrowsePage *page;
+        gchar *key;
+
+        player->restoring = NULL;
+        player->current_source = source;
+        wgp_navigation_set_object (player->navigation, 1, source);
+        webkit_dom_node_set_text_content (
+                player->main_node,
+                wgp_view_strdup_printf (player->current_view,
+                                        "Source selected: %s",
+                                        session->source_name),
+                NULL);
+
+        if (session->items->len > 0) {
+                key = wgp_cache_make_key (player->current_source,
+                                          player->current_container,
+                                          0,
+                                          wgp_metadata_get_fast_keys ());
+                page = browse_page_new (player,
+                                        key,
+                                        0,
+                                        session->items->len,
+                                        session->items);
+                page->operation = wgp_scheduler_browse (
+                        WGP_SCHEDULER_VISIBLE,
+                        player->current_source,
+                        player->current_container,
+                        wgp_metadata_get_fast_keys (),
+                        0, session->items->len,
+                        GRL_RESOLVE_FAST_ONLY,
+                        browse_source_cb,
+                        page);
+                player->browse_pages = g_list_prepend (player->browse_pages, page);
+                g_free (key);
+        }
+
+        /* Only whole pages were kept, there may be more */
+        if (session->items->len % WGP_LISTING_PAGE_SIZE == 0) {
+                wgp_listing_start_paging (player->listing);
+        }
+
+        wgp_session_free (session);
+}
+
+
+static void
+source_added_cb (GrlPluginRegistry *registry,
+                 GrlMediaPlugin *source,
+                 gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+        const gchar *source_name;
+        const gchar *source_id;
+
+        source_name = grl_metadata_source_get_name (
+                GRL_METADATA_SOURCE (source));
+        source_id = grl_metadata_source_get_id (GRL_METADATA_SOURCE (source));
+        g_debug ("Detected new source available: '%s'", source_name);
+
+        if (g_strcmp0 (source_id, player->pending_source_id) == 0) {
+                source_clicked_cb (player, GRL_METADATA_SOURCE (source));
+                return;
+        }
+
+        if (player->restoring &&
+            g_strcmp0 (source_id, player->restoring->source_id) == 0) {
+                revalidate_session (player, GRL_MEDIA_SOURCE (source));
+                return;
+        }
+
+        /* Already shown by its placeholder until all plugins are loaded */
+        if (player->showing_sources &&
+            !g_hash_table_lookup (player->placeholders, source_id)) {
+                show_item (player, source);
+
+                if (!first_source_shown) {
+                        first_source_shown = TRUE;
+                        wgp_player_startup_mark ("first source shown");
+                }
+        }
+}
+
+
+/* Stands for a source whose plugin is not loaded yet */
+static GrlMedia *
+placeholder_new (const gchar *source_id, const gchar *source_name)
+{
+        GrlMedia *placeholder;
+
+        placeholder = grl_media_box_new ();
+        grl_media_set_id (placeholder, source_id);
+        grl_media_set_title (placeholder, source_name);
+        g_object_set_data (G_OBJECT (placeholder),
+                           "wgp-placeholder",
+                           GUINT_TO_POINTER (TRUE));
+
+        return placeholder;
+}
+
+
+static void
+show_cached_source (const gchar *source_id,
+                    const gchar *source_name,
+                    gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+        GrlMedia *placeholder;
+
+        placeholder = placeholder_new (source_id, source_name);
+        g_hash_table_insert (player->placeholders, g_strdup (source_id), placeholder);
+        show_item (player, placeholder);
+
+        if (!first_source_shown) {
+                first_source_shown = TRUE;
+                wgp_player_startup_mark ("first source shown (cached)");
+        }
+}
+
+
+/* Every plugin is loaded, the sources still missing are gone */
+static void
+sources_loaded (WgpPlayer *player)
+{
+        GrlMediaPlugin *source;
+        gchar *source_name;
+
+        if (player->restoring) {
+                source = grl_plugin_registry_lookup_source (
+                        registry,
+                        player->restoring->source_id);
+                if (source) {
+                        revalidate_session (player, GRL_MEDIA_SOURCE (source));
+                } else {
+                        source_name = g_strdup (player->restoring->source_name);
+                        plugins_clicked_cb (player);
+                        set_status (player,
+                                    wgp_view_strdup_printf (player->current_view,
+                                                            "Source not available: %s",
+                                                            source_name));
+                        g_free (source_name);
+                }
+        }
+
+        /* Replace the placeholders by the real sources */
+        g_hash_table_remove_all (player->placeholders);
+        if (player->showing_sources) {
+                plugins_clicked_cb (player);
+        }
+}
+
+
+static void
+plugins_loaded_cb (gpointer user_data)
+{
+        GList *l;
+
+        plugins_loaded = TRUE;
+        wgp_player_startup_mark ("all sources loaded");
+
+        wgp_loader_save_sources (registry);
+
+        for (l = players; l; l = l->next) {
+                sources_loaded (l->data);
+        }
+}
+
+
+/* Paints the screen of the last run, revalidated once its source is loaded */
+static gboolean
+restore_session (WgpPlayer *player)
+{
+        GrlMedia *placeholder;
+        guint i;
+
+        player->restoring = wgp_session_load (player->index);
+        if (player->restoring == NULL) {
+                return FALSE;
+        }
+
+        placeholder = placeholder_new (player->restoring->source_id,
+                                       player->restoring->source_name);
+        wgp_navigation_push (player->navigation, placeholder, NULL);
+        g_object_unref (placeholder);
+
+        for (i = 0; i < player->restoring->path->len; i++) {
+                wgp_navigation_push (player->navigation,
+                                     g_ptr_array_index (player->restoring->path, i),
+                                     NULL);
+        }
+        if (player->restoring->path->len > 0) {
+                player->current_container = g_object_ref (
+                        g_ptr_array_index (player->restoring->path,
+                                           player->restoring->path->len - 1));
+        }
+
+        webkit_dom_node_set_text_content (
+                player->main_node,
+                wgp_view_strdup_printf (player->current_view,
+                                        "Loading source: %s",
+                                        player->restoring->source_name),
+                NULL);
+
+        browse_page_append (player, player->restoring->items);
+        wgp_listing_set_scroll_top (player->listing, player->restoring->scroll_top);
+        wgp_player_startup_mark ("last session shown");
+
+        return TRUE;
+}
+
+
+/* Plugins are loaded once, by the first window */
+static void
+load_grilo_plugins (WgpPlayer *player)
+{
+        if (!restore_session (player)) {
+                webkit_dom_node_set_text_content (
+                        player->main_node,
+                        "Grilo plugins",
+                        NULL);
+                player->showing_sources = TRUE;
+
+                if (!plugins_loaded) {
+                        wgp_loader_foreach_cached_source (show_cached_source,
+                                                          player);
+                }
+        }
+
+        if (plugins_loaded) {
+                sources_loaded (player);
+        } else if (!plugins_loading) {
+                /* Load grilo plugins once the window is painted */
+                plugins_loading = TRUE;
+                wgp_loader_load_async (registry, plugins_loaded_cb, NULL);
+        }
+}
+
+static void
+fill_about (WgpPlayer *player, WebKitDOMNode *about_node)
+{
+        WebKitDOMNode *about_dialog_node = NULL;
+        WebKitDOMElement *icon = NULL;
+        WebKitDOMElement *element = NULL;
+        gchar *text = NULL;
+
+        icon = webkit_dom_document_create_element (player->document, "img", NULL);
+        webkit_dom_element_set_attribute (icon, "src", "/usr/share/icons/Tango/32x32/apps/help-browser.png", NULL);
+        webkit_dom_element_set_attribute (icon, "title", "About", NULL);
+        webkit_dom_element_set_attribute (icon, "onClick", "$('#about_dialog').dialog('open');", NULL);
+        webkit_dom_node_append_child (about_node,
+                                      WEBKIT_DOM_NODE (icon),
+                                      NULL);
+
+        element = webkit_dom_document_create_element (player->document, "p", NULL);
+        text = g_strdup_printf ("%s - %s",
+                                PACKAGE_STRING,
+                                "Desktop application developed in HTML using " \
+                                "WebKitGTK+ to play multimedia content provided by Grilo.");
+        webkit_dom_node_set_text_content (WEBKIT_DOM_NODE (element),
+                                          text,
+                                          NULL);
+        g_free (text);
+
+        about_dialog_node = WEBKIT_DOM_NODE (
+                webkit_dom_document_get_element_by_id (player->document, "about_dialog"));
+        webkit_dom_node_append_child (about_dialog_node,
+                                      WEBKIT_DOM_NODE (element),
+                                      NULL);
+}
+
+static void
+web_view_loaded_cb (WebKitWebView *view,
+                    WebKitWebFrame *frame,
+                    gpointer user_data)
+{
+        WgpPlayer *player = user_data;
+        WebKitDOMNode *about_node = NULL;
+
+        wgp_player_startup_mark ("document loaded");
+
+        player->document = webkit_web_view_get_dom_document (view);
+
+        player->sources_node = WEBKIT_DOM_NODE (
+                webkit_dom_document_get_element_by_id (player->document, "sources"));
+        player->main_node = WEBKIT_DOM_NODE (
+                webkit_dom_document_get_element_by_id (player->document, "main"));
+        player->status_node = WEBKIT_DOM_NODE (
+                webkit_dom_document_get_element_by_id (player->document, "status"));
+        about_node = WEBKIT_DOM_NODE (
+                webkit_dom_document_get_element_by_id (player->document, "about"));
+
+        g_signal_connect (webkit_dom_document_get_element_by_id (player->document,
+                                                                 "breadcrumbs"),
+                          "click-event",
+                          G_CALLBACK (breadcrumbs_clicked_cb),
+                          player);
+        g_signal_connect (webkit_dom_document_get_element_by_id (player->document,
+                                                                 "status"),
+                          "click-event",
+                          G_CALLBACK (status_clicked_cb),
+                          player);
+        g_signal_connect (webkit_dom_document_get_element_by_id (player->document,
+                                                                 "search"),
+                          "change-event",
+                          G_CALLBACK (search_changed_cb),
+                          player);
+        g_signal_connect (webkit_dom_document_get_element_by_id (player->document,
+                                                                 "filter"),
+                          "keyup-event",
+                          G_CALLBACK (filter_changed_cb),
+                          player);
+        g_signal_connect (webkit_dom_document_get_element_by_id (player->document,
+                                                                 "sort"),
+                          "change-event",
+                          G_CALLBACK (sort_changed_cb),
+                          player);
+
+        player->current_view = wgp_view_new ();
+        player->listing = wgp_listing_new (player->document,
+                                           player->sources_node,
+                                           fetch_page_cb,
+                                           item_activated_cb,
+                                           player);
+        wgp_listing_set_batching (player->listing, batch_size, flush_interval);
+        wgp_listing_set_row_func (player->listing, row_shown_cb, player);
+        wgp_listing_set_row_hidden_func (player->listing, row_hidden_cb, player);
+        player->queue = wgp_queue_new (player->document,
+                                       player->main_node,
+                                       get_queue_source,
+                                       player);
+
+        /* Initi DOM */
+        player->navigation = wgp_navigation_new (view,
+                                                 "breadcrumbs",
+                                                 "Plugins",
+                                                 (GDestroyNotify) screen_free);
+        fill_about (player, about_node);
+
+        registry = grl_plugin_registry_get_default ();
+        g_signal_connect (registry,
+                          "source-added",
+                          G_CALLBACK (source_added_cb),
+                          player);
+
+        if (player->load_plugins) {
+                load_grilo_plugins (player);
+        } else {
+                plugins_loaded = TRUE;
+        }
+
+        if (player->ready_func) {
+                player->ready_func (player->ready_data);
+        }
+}
+
+
+void
+wgp_player_print_stats (void)
+{
+        guint hits;
+        guint misses;
+        guint evictions;
+        gsize size;
+        guint prefetch_hits;
+        guint prefetch_misses;
+        guint prefetch_wasted;
+        WgpSchedulerPriority priority;
+        guint queued;
+        guint started;
+        gdouble average_wait;
+        gdouble max_wait;
+        guint retries;
+        guint timeouts;
+        guint rejected;
+
+        wgp_cache_get_stats (&hits, &misses, &evictions, &size);
+        wgp_prefetch_get_stats (&prefetch_hits, &prefetch_misses, &prefetch_wasted);
+        g_message ("Live objects: %u, view arenas: %" G_GSIZE_FORMAT " bytes, "
+                   "browse cache: %u hits, %u misses, %u evictions, %" G_GSIZE_FORMAT " bytes, "
+                   "prefetch: %u hits, %u misses, %u wasted",
+                   wgp_view_get_live_objects (),
+                   wgp_view_get_arena_bytes (),
+                   hits, misses, evictions, size,
+                   prefetch_hits, prefetch_misses, prefetch_wasted);
+
+        for (priority = 0; priority < WGP_SCHEDULER_N_PRIORITIES; priority++) {
+                wgp_scheduler_get_stats (priority,
+                                         &queued,
+                                         &started,
+                                         &average_wait,
+                                         &max_wait);
+                g_message ("Scheduler priority %u: %u queued, %u started, "
+                           "%.1f ms average wait, %.1f ms max wait",
+                           priority, queued, started, average_wait, max_wait);
+        }
+
+        wgp_scheduler_get_failures (&retries, &timeouts, &rejected);
+        g_message ("Scheduler failures: %u retries, %u timeouts, "
+                   "%u rejected by degraded sources",
+                   retries, timeouts, rejected);
+}
+
+
+/* Saves the current screen, to be shown again on next start */
+void
+wgp_player_save_session (WgpPlayer *player)
+{
+        WgpSession *session;
+        gpointer source;
+        guint depth;
+        guint rows;
+        guint i;
+
+        /* The one of the last run is still there */
+        if (player->navigation == NULL || player->restoring) {
+                return;
+        }
+
+        depth = wgp_navigation_get_depth (player->navigation);
+        source = wgp_navigation_get_object (player->navigation, 1);
+
+        /* Search results are not kept, next start shows the root */
+        if (source == NULL || GRL_IS_MEDIA (source)) {
+                wgp_session_save (player->index, NULL);
+                return;
+        }
+
+        /* Whole pages, down to the last row rendered */
+        rows = wgp_listing_get_rendered_end (player->listing);
+        rows = (rows + WGP_LISTING_PAGE_SIZE - 1) /
+                WGP_LISTING_PAGE_SIZE * WGP_LISTING_PAGE_SIZE;
+        rows = MIN (rows, WGP_SESSION_MAX_ROWS);
+        rows = MIN (rows, wgp_listing_get_n_appended (player->listing));
+
+        /* Scrolled past the rows kept, it is restored at their end */
+        session = wgp_session_new (
+                grl_metadata_source_get_id (GRL_METADATA_SOURCE (source)),
+                grl_metadata_source_get_name (GRL_METADATA_SOURCE (source)),
+                MIN (wgp_listing_get_scroll_top (player->listing),
+                     (glong) rows * WGP_LISTING_ROW_HEIGHT));
+
+        for (i = 2; i <= depth; i++) {
+                g_ptr_array_add (session->path,
+                                 g_object_ref (wgp_navigation_get_object (
+                                                       player->navigation, i)));
+        }
+
+        for (i = 0; i < rows; i++) {
+                g_ptr_array_add (session->items,
+                                 g_object_ref (wgp_listing_get_appended (
+                                                       player->listing, i)));
+        }
+
+        wgp_session_save (player->index, session);
+        wgp_session_free (session);
+}
+
+
+/* The window is closed, nothing is prefetched for it any more */
+static void
+web_view_destroyed_cb (GtkWidget *web_view, gpointer user_data)
+{
+        wgp_prefetch_forget (user_data);
+}
+
+
+/*
+ * Loads the user interface in @web_view, as a new window of the player. When
+ * @load_plugins is FALSE no Grilo plugin is loaded, only the sources already
+ * in the registry are shown. @ready_func is called once the document is
+ * loaded.
+ *
+ * Every window has its own navigation, listing and queue, while the registry,
+ * the caches and the scheduler are shared by all of them.
+ */
+WgpPlayer *
+wgp_player_new (WebKitWebView *web_view,
+                gboolean load_plugins,
+                WgpPlayerReadyFunc ready_func,
+                gpointer user_data)
+{
+        WgpPlayer *player;
+        gchar *uri_html;
+
+        if (start_time == 0) {
+                start_time = g_get_monotonic_time ();
+        }
+
+        player = g_slice_new0 (WgpPlayer);
+        player->index = g_list_length (players);
+        player->load_plugins = load_plugins;
+        player->ready_func = ready_func;
+        player->ready_data = user_data;
+
+        player->placeholders = g_hash_table_new_full (g_str_hash,
+                                                      g_str_equal,
+                                                      g_free,
+                                                      g_object_unref);
+
+        players = g_list_append (players, player);
+
+        /* Build URI for index.html file */
+        uri_html = g_filename_to_uri (HTML_DIR "index.html", NULL, NULL);
+
+        webkit_web_view_load_uri (web_view, uri_html);
+        g_signal_connect (web_view,
+                          "document-load-finished",
+                          G_CALLBACK (web_view_loaded_cb),
+                          player);
+        g_signal_connect (web_view,
+                          "destroy",
+                          G_CALLBACK (web_view_destroyed_cb),
+                          player);
+
+        g_free (uri_html);
+
+        return player;
+}
+
+void
+wgp_player_set_batching (guint size, guint interval)
+{
+        batch_size = MAX (size, 1);
+        flush_interval = interval;
+}
+
+void
+wgp_player_set_search_deadline (guint deadline)
+{
+        search_deadline = deadline;
+}
+
+void
+wgp_player_set_browse_func (WgpPlayer *player,
+                            WgpPlayerBrowseFunc func,
+                            gpointer user_data)
+{
+        player->browse_func = func;
+        player->browse_data = user_data;
+}
+
+void
+wgp_player_open_source (WgpPlayer *player, GrlMediaSource *source)
+{
+        source_clicked_cb (player, GRL_METADATA_SOURCE (source));
+}
+
+/* Same as clicking the row at @index */
+void
+wgp_player_activate (WgpPlayer *player, guint index)
+{
+        gpointer object;
+
+        object = wgp_listing_get_item (player->listing, index);
+        if (object) {
+                open_item (player, object);
+        }
+}
+
+WgpListing *
+wgp_player_get_listing (WgpPlayer *player)
+{
+        return player->listing;
+}
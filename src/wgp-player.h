@@ -0,0 +1,77 @@
+/*
+ * wgp-player.h: Player user interface
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_PLAYER_H__
+#define __WGP_PLAYER_H__
+
+#include <webkit/webkit.h>
+#include <grilo.h>
+#include "wgp-listing.h"
+
+
+typedef struct _WgpPlayer WgpPlayer;
+
+typedef void (*WgpPlayerReadyFunc) (gpointer user_data);
+
+/* Called for every browse result shown, @remaining as given by Grilo */
+typedef void (*WgpPlayerBrowseFunc) (GrlMedia *media,
+                                     guint remaining,
+                                     gpointer user_data);
+
+
+WgpPlayer *
+wgp_player_new (WebKitWebView *web_view,
+                gboolean load_plugins,
+                WgpPlayerReadyFunc ready_func,
+                gpointer user_data);
+
+void
+wgp_player_set_batching (guint batch_size, guint flush_interval);
+
+void
+wgp_player_set_search_deadline (guint deadline);
+
+void
+wgp_player_set_browse_func (WgpPlayer *player,
+                            WgpPlayerBrowseFunc browse_func,
+                            gpointer user_data);
+
+void
+wgp_player_open_source (WgpPlayer *player, GrlMediaSource *source);
+
+void
+wgp_player_activate (WgpPlayer *player, guint index);
+
+WgpListing *
+wgp_player_get_listing (WgpPlayer *player);
+
+void
+wgp_player_startup_begin (void);
+
+void
+wgp_player_startup_mark (const gchar *what);
+
+void
+wgp_player_print_stats (void);
+
+void
+wgp_player_save_session (WgpPlayer *player);
+
+
+#endif
@@ -0,0 +1,476 @@
+/*
+ * wgp-prefetch.c: Prefetch of the likely next containers
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wgp-prefetch.h"
+#include "wgp-cache.h"
+#include "wgp-listing.h"
+#include "wgp-metadata.h"
+#include "wgp-scheduler.h"
+#include "wgp-watchdog.h"
+
+/*
+ * Once a container is shown, the first page of the containers the user is
+ * most likely to open next is browsed when the main loop is idle and left in
+ * the browse cache. Candidates are given by the player, most likely first.
+ *
+ * A navigation cancels everything in flight, though running prefetches are
+ * only cancelled once the new screen had the chance to take over the one of
+ * the container it opens. The next page fetched tells whether the prediction
+ * was right: a hit if it was prefetched, a miss otherwise, and every other
+ * page prefetched is counted as wasted.
+ *
+ * Every prefetch belongs to the window that asked for it, so navigating in
+ * one window neither cancels nor counts the prefetches of the others. What is
+ * kept for a window outlives its navigations, as the hits are only known
+ * once the next screen fetches its first page, and is dropped with
+ * wgp_prefetch_forget() when the window goes away.
+ */
+
+typedef struct {
+        guint added;
+
+        /* Keys prefetched and not used yet */
+        GHashTable *prefetched;
+} Owner;
+
+typedef struct {
+        Owner *owner;
+        GrlMediaSource *source;
+        GrlMedia *container;
+        gchar *key;
+        WgpOperation *operation;
+        gboolean stopping;
+        gboolean cancelled;
+        GPtrArray *items;
+
+        /* Set once taken over by wgp_prefetch_take() */
+        GrlMediaSourceResultCb callback;
+        gpointer user_data;
+} Prefetch;
+
+static guint max_containers = WGP_PREFETCH_DEFAULT_CONTAINERS;
+static guint per_source = WGP_PREFETCH_DEFAULT_PER_SOURCE;
+
+static GQueue queue = G_QUEUE_INIT;
+static GList *running = NULL;
+static guint idle_id = 0;
+static guint cancel_id = 0;
+
+/* Number of operations running per source */
+static GHashTable *source_counts = NULL;
+
+static GHashTable *owners = NULL;
+
+static guint hits = 0;
+static guint misses = 0;
+static guint wasted = 0;
+
+
+static void
+prefetch_free (Prefetch *prefetch)
+{
+        g_object_unref (prefetch->source);
+        if (prefetch->container) {
+                g_object_unref (prefetch->container);
+        }
+        g_free (prefetch->key);
+        if (prefetch->items) {
+                g_ptr_array_unref (prefetch->items);
+        }
+        g_slice_free (Prefetch, prefetch);
+}
+
+static Owner *
+get_owner (gpointer key)
+{
+        Owner *owner;
+
+        owner = g_hash_table_lookup (owners, key);
+        if (owner == NULL) {
+                owner = g_slice_new0 (Owner);
+                owner->prefetched = g_hash_table_new_full (g_str_hash,
+                                                           g_str_equal,
+                                                           g_free,
+                                                           NULL);
+                g_hash_table_insert (owners, key, owner);
+        }
+
+        return owner;
+}
+
+static guint
+get_source_count (GrlMediaSource *source)
+{
+        return GPOINTER_TO_UINT (g_hash_table_lookup (source_counts, source));
+}
+
+static void
+set_source_count (GrlMediaSource *source, guint count)
+{
+        g_hash_table_insert (source_counts, source, GUINT_TO_POINTER (count));
+}
+
+static gboolean start_cb (gpointer user_data);
+
+static void
+browse_cb (GrlMediaSource *source,
+           guint browse_id,
+           GrlMedia *media,
+           guint remaining,
+           gpointer user_data,
+           const GError *error)
+{
+        Prefetch *prefetch = user_data;
+
+        if (prefetch->callback) {
+                prefetch->callback (source, browse_id, media, remaining,
+                                    prefetch->user_data, error);
+                if (remaining == 0) {
+                        prefetch_free (prefetch);
+                }
+                return;
+        }
+
+        if (media) {
+                g_ptr_array_add (prefetch->items, media);
+        }
+
+        if (remaining > 0) {
+                return;
+        }
+
+        /* Cancelled ones were already taken out */
+        if (!prefetch->cancelled) {
+                running = g_list_remove (running, prefetch);
+                set_source_count (source, get_source_count (source) - 1);
+
+                if (error) {
+                        g_debug ("Prefetch failed: %s", error->message);
+                } else {
+                        g_debug ("Prefetched: %s", prefetch->key);
+                        wgp_cache_insert (
+                                prefetch->key,
+                                grl_metadata_source_get_id (GRL_METADATA_SOURCE (source)),
+                                prefetch->items);
+                        g_hash_table_add (prefetch->owner->prefetched,
+                                          g_strdup (prefetch->key));
+                }
+
+                if (!g_queue_is_empty (&queue) && idle_id == 0) {
+                        idle_id = g_idle_add_full (G_PRIORITY_LOW,
+                                                   start_cb,
+                                                   NULL,
+                                                   NULL);
+                }
+        }
+
+        prefetch_free (prefetch);
+}
+
+/* Cancels the running prefetches at @l, freed on their last result */
+static void
+cancel_running (GList *l)
+{
+        Prefetch *prefetch = l->data;
+
+        running = g_list_delete_link (running, l);
+        set_source_count (prefetch->source,
+                          get_source_count (prefetch->source) - 1);
+        prefetch->cancelled = TRUE;
+        wgp_scheduler_cancel (prefetch->operation);
+}
+
+/* Cancels the prefetches nobody took over since the last navigation */
+static gboolean
+cancel_cb (gpointer user_data)
+{
+        GList *l;
+        GList *next;
+
+        cancel_id = 0;
+
+        for (l = running; l; l = next) {
+                next = l->next;
+                if (((Prefetch *) l->data)->stopping) {
+                        cancel_running (l);
+                }
+        }
+
+        return FALSE;
+}
+
+/* Starts every queued prefetch allowed by the limit of its source */
+static gboolean
+start_cb (gpointer user_data)
+{
+        Prefetch *prefetch;
+        GList *l;
+        GList *next;
+
+        wgp_watchdog_enter (G_STRFUNC);
+        idle_id = 0;
+
+        for (l = queue.head; l; l = next) {
+                next = l->next;
+                prefetch = l->data;
+
+                if (get_source_count (prefetch->source) >= per_source) {
+                        continue;
+                }
+
+                g_queue_delete_link (&queue, l);
+                if (wgp_cache_contains (prefetch->key)) {
+                        prefetch_free (prefetch);
+                        continue;
+                }
+
+                set_source_count (prefetch->source,
+                                  get_source_count (prefetch->source) + 1);
+                prefetch->items = g_ptr_array_new_with_free_func (g_object_unref);
+                running = g_list_prepend (running, prefetch);
+                prefetch->operation = wgp_scheduler_browse (
+                        WGP_SCHEDULER_PREFETCH,
+                        prefetch->source,
+                        prefetch->container,
+                        wgp_metadata_get_fast_keys (),
+                        0, WGP_LISTING_PAGE_SIZE,
+                        GRL_RESOLVE_FAST_ONLY | GRL_RESOLVE_IDLE_RELAY,
+                        browse_cb,
+                        prefetch);
+        }
+
+        wgp_watchdog_leave ();
+
+        return FALSE;
+}
+
+
+void
+wgp_prefetch_init (guint containers, guint source_limit)
+{
+        max_containers = containers;
+        per_source = MAX (source_limit, 1);
+
+        source_counts = g_hash_table_new (g_direct_hash, g_direct_equal);
+        owners = g_hash_table_new (g_direct_hash, g_direct_equal);
+}
+
+/*
+ * Queues the first page of @container (NULL for the root) of @source for
+ * @owner. Only the first containers added since the last
+ * wgp_prefetch_cancel() of @owner are kept.
+ */
+void
+wgp_prefetch_add (gpointer owner,
+                  GrlMediaSource *source,
+                  GrlMedia *container)
+{
+        Prefetch *prefetch;
+        Owner *data;
+        gchar *key;
+
+        if (owners == NULL) {
+                return;
+        }
+
+        data = get_owner (owner);
+        if (data->added >= max_containers ||
+            wgp_scheduler_is_degraded (source)) {
+                return;
+        }
+
+        key = wgp_cache_make_key (source, container, 0, wgp_metadata_get_fast_keys ());
+        if (wgp_cache_contains (key)) {
+                g_free (key);
+                return;
+        }
+
+        prefetch = g_slice_new0 (Prefetch);
+        prefetch->owner = data;
+        prefetch->source = g_object_ref (source);
+        prefetch->container = container ? g_object_ref (container) : NULL;
+        prefetch->key = key;
+        g_queue_push_tail (&queue, prefetch);
+        data->added++;
+}
+
+/* Starts the queued prefetches once the main loop is idle */
+void
+wgp_prefetch_start (void)
+{
+        if (!g_queue_is_empty (&queue) && idle_id == 0) {
+                idle_id = g_idle_add_full (G_PRIORITY_LOW, start_cb, NULL, NULL);
+        }
+}
+
+/* Drops what was queued for @owner, its running prefetches are cancelled soon */
+void
+wgp_prefetch_cancel (gpointer owner)
+{
+        Prefetch *prefetch;
+        Owner *data;
+        GList *l;
+        GList *next;
+
+        if (owners == NULL) {
+                return;
+        }
+
+        data = get_owner (owner);
+
+        for (l = queue.head; l; l = next) {
+                next = l->next;
+                prefetch = l->data;
+                if (prefetch->owner == data) {
+                        g_queue_delete_link (&queue, l);
+                        prefetch_free (prefetch);
+                }
+        }
+
+        /* Left for the new screen to take over until the main loop runs */
+        for (l = running; l; l = l->next) {
+                prefetch = l->data;
+                if (prefetch->owner == data) {
+                        prefetch->stopping = TRUE;
+                        if (cancel_id == 0) {
+                                cancel_id = g_idle_add_full (G_PRIORITY_HIGH,
+                                                             cancel_cb,
+                                                             NULL,
+                                                             NULL);
+                        }
+                }
+        }
+
+        data->added = 0;
+}
+
+/*
+ * Hands the running prefetch of @key for @owner over to @callback, as if the
+ * caller had started it: the results received so far are given at once and
+ * the rest as they arrive. Returns its operation, or NULL if there is none.
+ */
+WgpOperation *
+wgp_prefetch_take (gpointer owner,
+                   const gchar *key,
+                   GrlMediaSourceResultCb callback,
+                   gpointer user_data)
+{
+        Prefetch *prefetch = NULL;
+        Owner *data;
+        GPtrArray *items;
+        GList *l;
+        guint i;
+
+        if (owners == NULL) {
+                return NULL;
+        }
+
+        data = get_owner (owner);
+        for (l = running; l; l = l->next) {
+                if (((Prefetch *) l->data)->owner == data &&
+                    g_strcmp0 (((Prefetch *) l->data)->key, key) == 0) {
+                        prefetch = l->data;
+                        break;
+                }
+        }
+        if (prefetch == NULL) {
+                return NULL;
+        }
+
+        g_debug ("Prefetch taken over: %s", key);
+        running = g_list_delete_link (running, l);
+        set_source_count (prefetch->source,
+                          get_source_count (prefetch->source) - 1);
+        if (!g_queue_is_empty (&queue) && idle_id == 0) {
+                idle_id = g_idle_add_full (G_PRIORITY_LOW, start_cb, NULL, NULL);
+        }
+
+        /* Counted as a hit by wgp_prefetch_note_fetch() */
+        g_hash_table_add (data->prefetched, g_strdup (key));
+
+        prefetch->callback = callback;
+        prefetch->user_data = user_data;
+        wgp_scheduler_promote (prefetch->operation, WGP_SCHEDULER_INTERACTIVE);
+
+        items = prefetch->items;
+        prefetch->items = NULL;
+        for (i = 0; i < items->len; i++) {
+                callback (prefetch->source, 0, g_object_ref (items->pdata[i]), 1,
+                          user_data, NULL);
+        }
+        g_ptr_array_unref (items);
+
+        return prefetch->operation;
+}
+
+/* Called with the key of the first page of every container opened by @owner */
+void
+wgp_prefetch_note_fetch (gpointer owner, const gchar *key)
+{
+        Owner *data;
+
+        if (owners == NULL || max_containers == 0) {
+                return;
+        }
+
+        data = get_owner (owner);
+        if (g_hash_table_remove (data->prefetched, key)) {
+                hits++;
+        } else {
+                misses++;
+        }
+
+        wasted += g_hash_table_size (data->prefetched);
+        g_hash_table_remove_all (data->prefetched);
+}
+
+/* @owner is gone, all it asked for is dropped and what it did not use wasted */
+void
+wgp_prefetch_forget (gpointer owner)
+{
+        Owner *data;
+        GList *l;
+        GList *next;
+
+        if (owners == NULL ||
+            (data = g_hash_table_lookup (owners, owner)) == NULL) {
+                return;
+        }
+
+        wgp_prefetch_cancel (owner);
+        for (l = running; l; l = next) {
+                next = l->next;
+                if (((Prefetch *) l->data)->owner == data) {
+                        cancel_running (l);
+                }
+        }
+
+        wasted += g_hash_table_size (data->prefetched);
+        g_hash_table_remove (owners, owner);
+        g_hash_table_destroy (data->prefetched);
+        g_slice_free (Owner, data);
+}
+
+void
+wgp_prefetch_get_stats (guint *hit_count, guint *miss_count, guint *waste_count)
+{
+        *hit_count = hits;
+        *miss_count = misses;
+        *waste_count = wasted;
+}
@@ -0,0 +1,60 @@
+/*
+ * wgp-prefetch.h: Prefetch of the likely next containers
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_PREFETCH_H__
+#define __WGP_PREFETCH_H__
+
+#include <grilo.h>
+#include "wgp-scheduler.h"
+
+#define WGP_PREFETCH_DEFAULT_CONTAINERS 3
+#define WGP_PREFETCH_DEFAULT_PER_SOURCE 1
+
+
+void
+wgp_prefetch_init (guint max_containers, guint per_source);
+
+void
+wgp_prefetch_add (gpointer owner,
+                  GrlMediaSource *source,
+                  GrlMedia *container);
+
+void
+wgp_prefetch_start (void);
+
+void
+wgp_prefetch_cancel (gpointer owner);
+
+WgpOperation *
+wgp_prefetch_take (gpointer owner,
+                   const gchar *key,
+                   GrlMediaSourceResultCb callback,
+                   gpointer user_data);
+
+void
+wgp_prefetch_note_fetch (gpointer owner, const gchar *key);
+
+void
+wgp_prefetch_forget (gpointer owner);
+
+void
+wgp_prefetch_get_stats (guint *hits, guint *misses, guint *wasted);
+
+
+#endif
@@ -0,0 +1,327 @@
+/*
+ * wgp-queue.c: Play queue
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wgp-queue.h"
+#include "wgp-metadata.h"
+#include "wgp-watchdog.h"
+
+/*
+ * Audio and video items are played one after the other. While one plays the
+ * next one is buffered in a hidden element, and when the first one ends the
+ * hidden element is shown and started, so the next track starts at once
+ * instead of loading from zero. Items whose URL is not known yet are resolved
+ * ahead of time at visible priority.
+ */
+
+struct _WgpQueue {
+        WebKitDOMDocument *document;
+        WebKitDOMNode *container;
+        WgpQueueSourceFunc source_func;
+        gpointer source_data;
+
+        GPtrArray *items;
+        guint current;
+
+        WebKitDOMElement *title;
+        WebKitDOMElement *line_break;
+        WebKitDOMElement *playing;
+
+        /* Hidden, buffering the item at next_index */
+        WebKitDOMElement *next;
+        guint next_index;
+
+        /* Only the last resolution requested is used */
+        GrlMedia *resolving;
+};
+
+
+static void start_current (WgpQueue *queue);
+static void prepare_next (WgpQueue *queue);
+
+
+gboolean
+wgp_queue_can_play (GrlMedia *media)
+{
+        return !GRL_IS_MEDIA_BOX (media) &&
+                (GRL_IS_MEDIA_AUDIO (media) || GRL_IS_MEDIA_VIDEO (media));
+}
+
+/* The caller may have cleared the container already */
+static void
+remove_node (WgpQueue *queue, WebKitDOMElement **element)
+{
+        if (*element == NULL) {
+                return;
+        }
+
+        if (webkit_dom_node_get_parent_node (WEBKIT_DOM_NODE (*element)) ==
+            queue->container) {
+                webkit_dom_node_remove_child (queue->container,
+                                              WEBKIT_DOM_NODE (*element),
+                                              NULL);
+        }
+        *element = NULL;
+}
+
+static void
+remove_element (WgpQueue *queue, WebKitDOMElement **element)
+{
+        if (*element == NULL) {
+                return;
+        }
+
+        webkit_dom_html_media_element_pause (WEBKIT_DOM_HTML_MEDIA_ELEMENT (*element));
+        remove_node (queue, element);
+}
+
+static void
+ended_cb (WebKitDOMEventTarget *target, WebKitDOMEvent *event, WgpQueue *queue)
+{
+        if (WEBKIT_DOM_ELEMENT (target) != queue->playing) {
+                return;
+        }
+
+        wgp_watchdog_enter (G_STRFUNC);
+        if (queue->current + 1 < queue->items->len) {
+                queue->current++;
+                start_current (queue);
+        }
+        wgp_watchdog_leave ();
+}
+
+static WebKitDOMElement *
+create_element (WgpQueue *queue, GrlMedia *media)
+{
+        WebKitDOMElement *element;
+
+        if (GRL_IS_MEDIA_VIDEO (media)) {
+                element = webkit_dom_document_create_element (queue->document,
+                                                              "video",
+                                                              NULL);
+                webkit_dom_element_set_attribute (element, "width", "400", NULL);
+        } else {
+                element = webkit_dom_document_create_element (queue->document,
+                                                              "audio",
+                                                              NULL);
+        }
+        webkit_dom_element_set_attribute (element, "controls", "controls", NULL);
+        webkit_dom_element_set_attribute (element, "preload", "auto", NULL);
+        webkit_dom_element_set_attribute (element, "src", grl_media_get_url (media), NULL);
+
+        webkit_dom_event_target_add_event_listener (WEBKIT_DOM_EVENT_TARGET (element),
+                                                    "ended",
+                                                    G_CALLBACK (ended_cb),
+                                                    FALSE,
+                                                    queue);
+
+        return element;
+}
+
+static void
+resolved_cb (GrlMedia *media, gpointer user_data)
+{
+        WgpQueue *queue = user_data;
+
+        if (media != queue->resolving) {
+                return;
+        }
+        queue->resolving = NULL;
+
+        if (media == g_ptr_array_index (queue->items, queue->current) &&
+            queue->playing == NULL) {
+                start_current (queue);
+        } else {
+                prepare_next (queue);
+        }
+}
+
+static gboolean
+resolve (WgpQueue *queue, GrlMedia *media, WgpSchedulerPriority priority)
+{
+        if (grl_media_get_url (media) || wgp_metadata_is_resolved (media)) {
+                return TRUE;
+        }
+
+        queue->resolving = media;
+        wgp_metadata_resolve (priority,
+                              queue->source_func (media, queue->source_data),
+                              media,
+                              resolved_cb,
+                              queue);
+
+        return FALSE;
+}
+
+/* Buffers the first item after the current one that can be played */
+static void
+prepare_next (WgpQueue *queue)
+{
+        GrlMedia *media = NULL;
+        guint index;
+
+        for (index = queue->current + 1; index < queue->items->len; index++) {
+                media = g_ptr_array_index (queue->items, index);
+                if (!resolve (queue, media, WGP_SCHEDULER_VISIBLE)) {
+                        return;
+                }
+                if (grl_media_get_url (media)) {
+                        break;
+                }
+        }
+
+        if (index >= queue->items->len || queue->next_index == index) {
+                return;
+        }
+
+        remove_element (queue, &queue->next);
+        queue->next = create_element (queue, media);
+        queue->next_index = index;
+        webkit_dom_element_set_attribute (queue->next, "style", "display: none", NULL);
+        webkit_dom_node_append_child (queue->container,
+                                      WEBKIT_DOM_NODE (queue->next),
+                                      NULL);
+        webkit_dom_html_media_element_load (WEBKIT_DOM_HTML_MEDIA_ELEMENT (queue->next),
+                                            NULL);
+
+        g_debug ("Buffering next media: %s", grl_media_get_title (media));
+}
+
+static void
+start_current (WgpQueue *queue)
+{
+        GrlMedia *media;
+        gchar *title;
+
+        media = g_ptr_array_index (queue->items, queue->current);
+        remove_element (queue, &queue->playing);
+
+        /* Waits for its URL, the current one is stopped meanwhile */
+        if (!resolve (queue, media, WGP_SCHEDULER_INTERACTIVE)) {
+                return;
+        }
+
+        if (grl_media_get_url (media) == NULL) {
+                g_debug ("Skipping media without URL: %s", grl_media_get_title (media));
+                if (queue->current + 1 < queue->items->len) {
+                        queue->current++;
+                        start_current (queue);
+                }
+                return;
+        }
+
+        if (queue->next && queue->next_index == queue->current) {
+                queue->playing = queue->next;
+                queue->next = NULL;
+                webkit_dom_element_remove_attribute (queue->playing, "style");
+        } else {
+                remove_element (queue, &queue->next);
+                queue->playing = create_element (queue, media);
+                webkit_dom_node_append_child (queue->container,
+                                              WEBKIT_DOM_NODE (queue->playing),
+                                              NULL);
+        }
+        queue->next_index = 0;
+        webkit_dom_html_media_element_play (WEBKIT_DOM_HTML_MEDIA_ELEMENT (queue->playing));
+
+        title = g_strdup_printf ("Playing: %s", grl_media_get_title (media));
+        webkit_dom_node_set_text_content (WEBKIT_DOM_NODE (queue->title), title, NULL);
+        g_free (title);
+
+        g_debug ("Play media: %s", grl_media_get_title (media));
+
+        prepare_next (queue);
+}
+
+
+/*
+ * Creates a queue playing in @container. @source_func gives the source of
+ * every media, to resolve the ones without URL.
+ */
+WgpQueue *
+wgp_queue_new (WebKitDOMDocument *document,
+               WebKitDOMNode *container,
+               WgpQueueSourceFunc source_func,
+               gpointer user_data)
+{
+        WgpQueue *queue;
+
+        queue = g_slice_new0 (WgpQueue);
+        queue->document = document;
+        queue->container = container;
+        queue->source_func = source_func;
+        queue->source_data = user_data;
+
+        return queue;
+}
+
+void
+wgp_queue_free (WgpQueue *queue)
+{
+        wgp_queue_stop (queue);
+        g_slice_free (WgpQueue, queue);
+}
+
+/*
+ * Plays @items, which are kept, starting by the one at @index. The elements
+ * are appended to the container and removed by wgp_queue_stop().
+ */
+void
+wgp_queue_play (WgpQueue *queue, GPtrArray *items, guint index)
+{
+        g_return_if_fail (index < items->len);
+
+        wgp_queue_stop (queue);
+
+        queue->items = g_ptr_array_ref (items);
+        queue->current = index;
+
+        queue->title = webkit_dom_document_create_element (queue->document,
+                                                           "span",
+                                                           NULL);
+        webkit_dom_node_append_child (queue->container,
+                                      WEBKIT_DOM_NODE (queue->title),
+                                      NULL);
+        queue->line_break = webkit_dom_document_create_element (queue->document,
+                                                                "br",
+                                                                NULL);
+        webkit_dom_node_append_child (queue->container,
+                                      WEBKIT_DOM_NODE (queue->line_break),
+                                      NULL);
+
+        start_current (queue);
+}
+
+/* Stops playing and removes every element added to the container */
+void
+wgp_queue_stop (WgpQueue *queue)
+{
+        if (queue->items == NULL) {
+                return;
+        }
+
+        remove_element (queue, &queue->playing);
+        remove_element (queue, &queue->next);
+        remove_node (queue, &queue->title);
+        remove_node (queue, &queue->line_break);
+        queue->next_index = 0;
+        queue->resolving = NULL;
+
+        g_ptr_array_unref (queue->items);
+        queue->items = NULL;
+}
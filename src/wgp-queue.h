@@ -0,0 +1,55 @@
+/*
+ * wgp-queue.h: Play queue
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_QUEUE_H__
+#define __WGP_QUEUE_H__
+
+#include <webkit/webkit.h>
+#include <grilo.h>
+
+/* Items of a container queued after the one clicked */
+#define WGP_QUEUE_MAX_ITEMS 1000
+
+
+typedef struct _WgpQueue WgpQueue;
+
+typedef GrlMediaSource *(*WgpQueueSourceFunc) (GrlMedia *media,
+                                                gpointer user_data);
+
+
+WgpQueue *
+wgp_queue_new (WebKitDOMDocument *document,
+               WebKitDOMNode *container,
+               WgpQueueSourceFunc source_func,
+               gpointer user_data);
+
+void
+wgp_queue_free (WgpQueue *queue);
+
+void
+wgp_queue_play (WgpQueue *queue, GPtrArray *items, guint index);
+
+void
+wgp_queue_stop (WgpQueue *queue);
+
+gboolean
+wgp_queue_can_play (GrlMedia *media);
+
+
+#endif
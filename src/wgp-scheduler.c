@@ -0,0 +1,829 @@
+/*
+ * wgp-scheduler.c: Scheduler of Grilo operations
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+#include "wgp-scheduler.h"
+#include "wgp-watchdog.h"
+
+/*
+ * Every operation sent to a source goes through here. Operations wait in one
+ * queue per source and priority, and are started while their source has less
+ * than source_limit operations running. Higher priorities go first, and
+ * sources take turns within the same priority so a busy one does not starve
+ * the rest. Interactive operations are never queued.
+ *
+ * Callers get their callbacks as if they had called Grilo directly, including
+ * the last one when they cancel an operation. The operation is freed after
+ * that last callback.
+ *
+ * Failed operations are retried with a jittered backoff, and every operation
+ * gets its last callback with WGP_SCHEDULER_ERROR_TIMED_OUT once its deadline
+ * passes, whatever the source does. Sources failing too many times in a row
+ * are degraded for a while, and their operations rejected meanwhile.
+ */
+
+typedef enum {
+        OPERATION_BROWSE,
+        OPERATION_SEARCH,
+        OPERATION_METADATA
+} OperationType;
+
+typedef enum {
+        STATUS_QUEUED,
+        STATUS_RUNNING,
+        STATUS_BACKOFF,
+        /* The last callback was delivered, the source may still answer */
+        STATUS_FINISHED
+} OperationStatus;
+
+typedef struct {
+        GrlMediaSource *source;
+        guint running;
+        gboolean in_ring;
+        GQueue queues[WGP_SCHEDULER_N_PRIORITIES];
+
+        guint failures;
+        gint64 degraded_until;
+} SourceState;
+
+struct _WgpOperation {
+        OperationType type;
+        OperationStatus status;
+        WgpSchedulerPriority priority;
+        SourceState *state;
+        GList link;
+
+        GrlMedia *media;
+        gchar *text;
+        GList *keys;
+        guint skip;
+        guint count;
+        GrlMetadataResolutionFlags flags;
+        GrlMediaSourceResultCb result_cb;
+        GrlMediaSourceMetadataCb metadata_cb;
+        const gchar *callback_name;
+        gpointer user_data;
+
+        guint id;
+        gint64 queued_time;
+        gboolean cancelled;
+        guint attempts;
+        guint delivered;
+        guint deadline_id;
+        guint retry_id;
+        GError *error;
+};
+
+typedef struct {
+        guint queued;
+        guint started;
+        gint64 total_wait;
+        gint64 max_wait;
+} PriorityStats;
+
+static guint source_limit = WGP_SCHEDULER_DEFAULT_SOURCE_LIMIT;
+static guint deadline = WGP_SCHEDULER_DEFAULT_DEADLINE;
+static guint max_retries = WGP_SCHEDULER_DEFAULT_RETRIES;
+static GHashTable *states = NULL;
+
+/* Sources with queued operations, in turn order */
+static GQueue ring = G_QUEUE_INIT;
+static guint dispatch_id = 0;
+
+static PriorityStats stats[WGP_SCHEDULER_N_PRIORITIES];
+static guint retries = 0;
+static guint timeouts = 0;
+static guint rejected = 0;
+
+
+static SourceState *
+get_state (GrlMediaSource *source)
+{
+        SourceState *state;
+        guint i;
+
+        if (states == NULL) {
+                states = g_hash_table_new (g_direct_hash, g_direct_equal);
+        }
+
+        state = g_hash_table_lookup (states, source);
+        if (state == NULL) {
+                state = g_slice_new0 (SourceState);
+                state->source = g_object_ref (source);
+                for (i = 0; i < WGP_SCHEDULER_N_PRIORITIES; i++) {
+                        g_queue_init (&state->queues[i]);
+                }
+                g_hash_table_insert (states, source, state);
+        }
+
+        return state;
+}
+
+static const gchar *
+get_name (SourceState *state)
+{
+        return grl_metadata_source_get_name (GRL_METADATA_SOURCE (state->source));
+}
+
+static gboolean
+has_queued (SourceState *state)
+{
+        guint i;
+
+        for (i = 0; i < WGP_SCHEDULER_N_PRIORITIES; i++) {
+                if (!g_queue_is_empty (&state->queues[i])) {
+                        return TRUE;
+                }
+        }
+
+        return FALSE;
+}
+
+static gboolean
+is_degraded (SourceState *state)
+{
+        return state->degraded_until > g_get_monotonic_time ();
+}
+
+/* Once the cooldown is over a single failure degrades the source again */
+static void
+record_result (SourceState *state, gboolean success)
+{
+        if (success) {
+                if (state->failures >= WGP_SCHEDULER_BREAKER_FAILURES) {
+                        g_message ("Source recovered: %s", get_name (state));
+                }
+                state->failures = 0;
+                return;
+        }
+
+        state->failures++;
+        if (state->failures >= WGP_SCHEDULER_BREAKER_FAILURES) {
+                if (!is_degraded (state)) {
+                        g_message ("Source degraded: %s", get_name (state));
+                }
+                state->degraded_until = g_get_monotonic_time () +
+                        WGP_SCHEDULER_BREAKER_COOLDOWN * G_USEC_PER_SEC;
+        }
+}
+
+static void
+remove_timeouts (WgpOperation *operation)
+{
+        if (operation->deadline_id) {
+                g_source_remove (operation->deadline_id);
+                operation->deadline_id = 0;
+        }
+        if (operation->retry_id) {
+                g_source_remove (operation->retry_id);
+                operation->retry_id = 0;
+        }
+}
+
+static void
+operation_free (WgpOperation *operation)
+{
+        remove_timeouts (operation);
+        if (operation->media) {
+                g_object_unref (operation->media);
+        }
+        g_free (operation->text);
+        g_list_free (operation->keys);
+        g_clear_error (&operation->error);
+        g_slice_free (WgpOperation, operation);
+}
+
+static void
+deliver_last (WgpOperation *operation, const GError *error)
+{
+        wgp_watchdog_enter (operation->callback_name);
+        if (operation->type == OPERATION_METADATA) {
+                operation->metadata_cb (operation->state->source,
+                                        operation->media,
+                                        operation->user_data,
+                                        error);
+        } else {
+                operation->result_cb (operation->state->source,
+                                      operation->id,
+                                      NULL,
+                                      0,
+                                      operation->user_data,
+                                      error);
+        }
+        wgp_watchdog_leave ();
+}
+
+static gboolean
+failed_cb (gpointer user_data)
+{
+        WgpOperation *operation = user_data;
+
+        deliver_last (operation, operation->error);
+        operation_free (operation);
+
+        return FALSE;
+}
+
+/* Ends an operation not holding a slot of its source, takes @error */
+static void
+fail_later (WgpOperation *operation, GError *error)
+{
+        remove_timeouts (operation);
+        operation->status = STATUS_FINISHED;
+        operation->error = error;
+        g_idle_add (failed_cb, operation);
+}
+
+static gboolean dispatch_cb (gpointer user_data);
+
+static void
+schedule_dispatch (void)
+{
+        if (dispatch_id == 0) {
+                dispatch_id = g_idle_add (dispatch_cb, NULL);
+        }
+}
+
+static void
+finish (WgpOperation *operation)
+{
+        operation->state->running--;
+        operation_free (operation);
+
+        schedule_dispatch ();
+}
+
+static void schedule (WgpOperation *operation);
+
+static gboolean
+retry_cb (gpointer user_data)
+{
+        WgpOperation *operation = user_data;
+
+        operation->retry_id = 0;
+        schedule (operation);
+
+        return FALSE;
+}
+
+/* Gives the slot back and tries again later, if it is worth it */
+static gboolean
+retry (WgpOperation *operation, const GError *error)
+{
+        guint delay;
+
+        if (operation->cancelled ||
+            operation->attempts > max_retries ||
+            is_degraded (operation->state)) {
+                return FALSE;
+        }
+
+        /* Results already handed over are not asked for again */
+        if (operation->type != OPERATION_METADATA) {
+                if (operation->count > 0 &&
+                    operation->delivered >= operation->count) {
+                        return FALSE;
+                }
+                operation->skip += operation->delivered;
+                if (operation->count > 0) {
+                        operation->count -= operation->delivered;
+                }
+                operation->delivered = 0;
+        }
+
+        delay = WGP_SCHEDULER_BACKOFF << (operation->attempts - 1);
+        delay = g_random_int_range (delay / 2, delay + delay / 2 + 1);
+        g_debug ("Retrying operation in '%s' in %u ms. Reason: %s",
+                 get_name (operation->state), delay, error->message);
+
+        retries++;
+        operation->status = STATUS_BACKOFF;
+        operation->state->running--;
+        operation->retry_id = g_timeout_add (delay, retry_cb, operation);
+        schedule_dispatch ();
+
+        return TRUE;
+}
+
+static void
+relay_result_cb (GrlMediaSource *source,
+                 guint operation_id,
+                 GrlMedia *media,
+                 guint remaining,
+                 gpointer user_data,
+                 const GError *error)
+{
+        WgpOperation *operation = user_data;
+
+        if (operation->status == STATUS_FINISHED) {
+                if (media) {
+                        g_object_unref (media);
+                }
+                if (remaining == 0) {
+                        operation_free (operation);
+                }
+                return;
+        }
+
+        if (remaining == 0) {
+                if (!operation->cancelled) {
+                        record_result (operation->state, error == NULL);
+                }
+                if (media == NULL && error && retry (operation, error)) {
+                        return;
+                }
+        }
+
+        if (media) {
+                operation->delivered++;
+        }
+
+        wgp_watchdog_enter (operation->callback_name);
+        operation->result_cb (source,
+                              operation_id,
+                              media,
+                              remaining,
+                              operation->user_data,
+                              error);
+        wgp_watchdog_leave ();
+
+        if (remaining == 0) {
+                finish (operation);
+        }
+}
+
+static void
+relay_metadata_cb (GrlMediaSource *source,
+                   GrlMedia *media,
+                   gpointer user_data,
+                   const GError *error)
+{
+        WgpOperation *operation = user_data;
+
+        if (operation->status == STATUS_FINISHED) {
+                operation_free (operation);
+                return;
+        }
+
+        if (!operation->cancelled) {
+                record_result (operation->state, error == NULL);
+        }
+        if (error && retry (operation, error)) {
+                return;
+        }
+
+        wgp_watchdog_enter (operation->callback_name);
+        operation->metadata_cb (source, media, operation->user_data, error);
+        wgp_watchdog_leave ();
+        finish (operation);
+}
+
+static gboolean
+deadline_cb (gpointer user_data)
+{
+        WgpOperation *operation = user_data;
+        SourceState *state = operation->state;
+        GError *error;
+
+        operation->deadline_id = 0;
+        timeouts++;
+
+        error = g_error_new (WGP_SCHEDULER_ERROR,
+                             WGP_SCHEDULER_ERROR_TIMED_OUT,
+                             "No answer from '%s' after %u ms",
+                             get_name (state),
+                             deadline);
+        g_debug ("%s", error->message);
+
+        switch (operation->status) {
+        case STATUS_RUNNING:
+                record_result (state, FALSE);
+                state->running--;
+                schedule_dispatch ();
+
+                /* Freed on the last callback of the source, if it ever comes */
+                operation->status = STATUS_FINISHED;
+                deliver_last (operation, error);
+                if (operation->type != OPERATION_METADATA) {
+                        grl_media_source_cancel (state->source, operation->id);
+                }
+                break;
+        case STATUS_QUEUED:
+        case STATUS_BACKOFF:
+                if (operation->status == STATUS_QUEUED) {
+                        g_queue_unlink (&state->queues[operation->priority],
+                                        &operation->link);
+                        stats[operation->priority].queued--;
+                }
+                operation->status = STATUS_FINISHED;
+                deliver_last (operation, error);
+                operation_free (operation);
+                break;
+        case STATUS_FINISHED:
+                break;
+        }
+
+        g_error_free (error);
+
+        return FALSE;
+}
+
+static void
+start (WgpOperation *operation)
+{
+        PriorityStats *priority_stats = &stats[operation->priority];
+        SourceState *state = operation->state;
+        gint64 wait;
+
+        if (is_degraded (state)) {
+                rejected++;
+                fail_later (operation,
+                            g_error_new (WGP_SCHEDULER_ERROR,
+                                         WGP_SCHEDULER_ERROR_DEGRADED,
+                                         "Source not responding: %s",
+                                         get_name (state)));
+                return;
+        }
+
+        if (operation->attempts == 0) {
+                wait = g_get_monotonic_time () - operation->queued_time;
+                priority_stats->started++;
+                priority_stats->total_wait += wait;
+                priority_stats->max_wait = MAX (priority_stats->max_wait, wait);
+
+                if (deadline > 0) {
+                        operation->deadline_id = g_timeout_add (deadline,
+                                                                deadline_cb,
+                                                                operation);
+                }
+        }
+
+        operation->status = STATUS_RUNNING;
+        operation->attempts++;
+        state->running++;
+
+        switch (operation->type) {
+        case OPERATION_BROWSE:
+                operation->id = grl_media_source_browse (state->source,
+                                                         operation->media,
+                                                         operation->keys,
+                                                         operation->skip,
+                                                         operation->count,
+                                                         operation->flags,
+                                                         relay_result_cb,
+                                                         operation);
+                break;
+        case OPERATION_SEARCH:
+                operation->id = grl_media_source_search (state->source,
+                                                         operation->text,
+                                                         operation->keys,
+                                                         operation->skip,
+                                                         operation->count,
+                                                         operation->flags,
+                                                         relay_result_cb,
+                                                         operation);
+                break;
+        case OPERATION_METADATA:
+                grl_media_source_metadata (state->source,
+                                           operation->media,
+                                           operation->keys,
+                                           operation->flags,
+                                           relay_metadata_cb,
+                                           operation);
+                break;
+        }
+}
+
+static void
+enqueue (WgpOperation *operation)
+{
+        SourceState *state = operation->state;
+
+        operation->status = STATUS_QUEUED;
+        g_queue_push_tail_link (&state->queues[operation->priority],
+                                &operation->link);
+        stats[operation->priority].queued++;
+
+        if (!state->in_ring) {
+                state->in_ring = TRUE;
+                g_queue_push_tail (&ring, state);
+        }
+}
+
+static void
+dequeue (WgpOperation *operation)
+{
+        g_queue_unlink (&operation->state->queues[operation->priority],
+                        &operation->link);
+        stats[operation->priority].queued--;
+}
+
+static void
+schedule (WgpOperation *operation)
+{
+        if (operation->priority == WGP_SCHEDULER_INTERACTIVE) {
+                start (operation);
+        } else {
+                enqueue (operation);
+                schedule_dispatch ();
+        }
+}
+
+/* Starts one operation per source and turn, while their limits allow it */
+static gboolean
+dispatch_cb (gpointer user_data)
+{
+        WgpSchedulerPriority priority;
+        SourceState *state;
+        GList *link;
+        gboolean progress;
+        guint turns;
+
+        wgp_watchdog_enter (G_STRFUNC);
+        dispatch_id = 0;
+
+        for (priority = 0; priority < WGP_SCHEDULER_N_PRIORITIES; priority++) {
+                do {
+                        progress = FALSE;
+                        for (turns = ring.length; turns > 0; turns--) {
+                                state = g_queue_pop_head (&ring);
+
+                                link = state->queues[priority].head;
+                                if (link && state->running < source_limit) {
+                                        dequeue (link->data);
+                                        start (link->data);
+                                        progress = TRUE;
+                                }
+
+                                if (has_queued (state)) {
+                                        g_queue_push_tail (&ring, state);
+                                } else {
+                                        state->in_ring = FALSE;
+                                }
+                        }
+                } while (progress);
+        }
+
+        wgp_watchdog_leave ();
+
+        return FALSE;
+}
+
+static WgpOperation *
+submit (WgpOperation *operation)
+{
+        operation->link.data = operation;
+        operation->queued_time = g_get_monotonic_time ();
+        schedule (operation);
+
+        return operation;
+}
+
+static WgpOperation *
+operation_new (OperationType type,
+               WgpSchedulerPriority priority,
+               GrlMediaSource *source,
+               GrlMedia *media,
+               const GList *keys,
+               GrlMetadataResolutionFlags flags,
+               gpointer user_data)
+{
+        WgpOperation *operation;
+
+        operation = g_slice_new0 (WgpOperation);
+        operation->type = type;
+        operation->priority = priority;
+        operation->state = get_state (source);
+        operation->media = media ? g_object_ref (media) : NULL;
+        operation->keys = g_list_copy ((GList *) keys);
+        operation->flags = flags;
+        operation->user_data = user_data;
+
+        return operation;
+}
+
+
+GQuark
+wgp_scheduler_error_quark (void)
+{
+        return g_quark_from_static_string ("wgp-scheduler-error-quark");
+}
+
+/*
+ * @limit is the number of operations running at once on a source, @timeout
+ * the deadline of every operation in milliseconds, 0 for none, and
+ * @retry_count the number of attempts after a failed one.
+ */
+void
+wgp_scheduler_init (guint limit, guint timeout, guint retry_count)
+{
+        source_limit = MAX (limit, 1);
+        deadline = timeout;
+        max_retries = retry_count;
+}
+
+WgpOperation *
+_wgp_scheduler_browse (WgpSchedulerPriority priority,
+                       GrlMediaSource *source,
+                       GrlMedia *container,
+                       const GList *keys,
+                       guint skip,
+                       guint count,
+                       GrlMetadataResolutionFlags flags,
+                       GrlMediaSourceResultCb callback,
+                       const gchar *callback_name,
+                       gpointer user_data)
+{
+        WgpOperation *operation;
+
+        operation = operation_new (OPERATION_BROWSE,
+                                   priority,
+                                   source,
+                                   container,
+                                   keys,
+                                   flags,
+                                   user_data);
+        operation->skip = skip;
+        operation->count = count;
+        operation->result_cb = callback;
+        operation->callback_name = callback_name;
+
+        return submit (operation);
+}
+
+WgpOperation *
+_wgp_scheduler_search (WgpSchedulerPriority priority,
+                       GrlMediaSource *source,
+                       const gchar *text,
+                       const GList *keys,
+                       guint skip,
+                       guint count,
+                       GrlMetadataResolutionFlags flags,
+                       GrlMediaSourceResultCb callback,
+                       const gchar *callback_name,
+                       gpointer user_data)
+{
+        WgpOperation *operation;
+
+        operation = operation_new (OPERATION_SEARCH,
+                                   priority,
+                                   source,
+                                   NULL,
+                                   keys,
+                                   flags,
+                                   user_data);
+        operation->text = g_strdup (text);
+        operation->skip = skip;
+        operation->count = count;
+        operation->result_cb = callback;
+        operation->callback_name = callback_name;
+
+        return submit (operation);
+}
+
+WgpOperation *
+_wgp_scheduler_metadata (WgpSchedulerPriority priority,
+                         GrlMediaSource *source,
+                         GrlMedia *media,
+                         const GList *keys,
+                         GrlMetadataResolutionFlags flags,
+                         GrlMediaSourceMetadataCb callback,
+                         const gchar *callback_name,
+                         gpointer user_data)
+{
+        WgpOperation *operation;
+
+        operation = operation_new (OPERATION_METADATA,
+                                   priority,
+                                   source,
+                                   media,
+                                   keys,
+                                   flags,
+                                   user_data);
+        operation->metadata_cb = callback;
+        operation->callback_name = callback_name;
+
+        return submit (operation);
+}
+
+/* Moves a waiting operation to a higher priority, like a clicked row */
+void
+wgp_scheduler_promote (WgpOperation *operation,
+                       WgpSchedulerPriority priority)
+{
+        if (priority >= operation->priority) {
+                return;
+        }
+
+        if (operation->status == STATUS_QUEUED) {
+                dequeue (operation);
+                operation->priority = priority;
+                schedule (operation);
+        } else if (operation->status == STATUS_BACKOFF) {
+                operation->priority = priority;
+        }
+}
+
+/* Queued operations wait behind the ones of @priority, running ones go on */
+void
+wgp_scheduler_demote (WgpOperation *operation,
+                      WgpSchedulerPriority priority)
+{
+        if (priority <= operation->priority) {
+                return;
+        }
+
+        if (operation->status == STATUS_QUEUED) {
+                dequeue (operation);
+                operation->priority = priority;
+                schedule (operation);
+        } else if (operation->status == STATUS_BACKOFF) {
+                operation->priority = priority;
+        }
+}
+
+void
+wgp_scheduler_cancel (WgpOperation *operation)
+{
+        GError *error = NULL;
+
+        switch (operation->status) {
+        case STATUS_RUNNING:
+                operation->cancelled = TRUE;
+                if (operation->type != OPERATION_METADATA) {
+                        grl_media_source_cancel (operation->state->source,
+                                                 operation->id);
+                }
+                break;
+        case STATUS_QUEUED:
+        case STATUS_BACKOFF:
+                if (operation->status == STATUS_QUEUED) {
+                        dequeue (operation);
+                }
+                if (operation->type == OPERATION_METADATA) {
+                        error = g_error_new_literal (G_IO_ERROR,
+                                                     G_IO_ERROR_CANCELLED,
+                                                     "Operation cancelled");
+                }
+                fail_later (operation, error);
+                break;
+        case STATUS_FINISHED:
+                break;
+        }
+}
+
+/*
+ * Gets the operations waiting with @priority, the ones started so far and
+ * their average and maximum wait in milliseconds.
+ */
+void
+wgp_scheduler_get_stats (WgpSchedulerPriority priority,
+                         guint *queued,
+                         guint *started,
+                         gdouble *average_wait,
+                         gdouble *max_wait)
+{
+        PriorityStats *priority_stats = &stats[priority];
+
+        *queued = priority_stats->queued;
+        *started = priority_stats->started;
+        *average_wait = priority_stats->started ?
+                priority_stats->total_wait / 1000.0 / priority_stats->started : 0;
+        *max_wait = priority_stats->max_wait / 1000.0;
+}
+
+void
+wgp_scheduler_get_failures (guint *retried,
+                            guint *timed_out,
+                            guint *rejected_degraded)
+{
+        *retried = retries;
+        *timed_out = timeouts;
+        *rejected_degraded = rejected;
+}
+
+gboolean
+wgp_scheduler_is_degraded (GrlMediaSource *source)
+{
+        SourceState *state;
+
+        state = states ? g_hash_table_lookup (states, source) : NULL;
+
+        return state != NULL && is_degraded (state);
+}
@@ -0,0 +1,142 @@
+/*
+ * wgp-scheduler.h: Scheduler of Grilo operations
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_SCHEDULER_H__
+#define __WGP_SCHEDULER_H__
+
+#include <grilo.h>
+
+#define WGP_SCHEDULER_DEFAULT_SOURCE_LIMIT 4
+
+/* Milliseconds an operation may take, retries included */
+#define WGP_SCHEDULER_DEFAULT_DEADLINE 10000
+
+/* Attempts after the first one failed */
+#define WGP_SCHEDULER_DEFAULT_RETRIES 2
+
+/* Milliseconds before the first retry, doubled on every attempt */
+#define WGP_SCHEDULER_BACKOFF 250
+
+/* Consecutive failures before a source is degraded, and for how long */
+#define WGP_SCHEDULER_BREAKER_FAILURES 5
+#define WGP_SCHEDULER_BREAKER_COOLDOWN 30
+
+#define WGP_SCHEDULER_ERROR wgp_scheduler_error_quark ()
+
+typedef enum {
+        WGP_SCHEDULER_ERROR_TIMED_OUT,
+        WGP_SCHEDULER_ERROR_DEGRADED
+} WgpSchedulerError;
+
+
+typedef enum {
+        WGP_SCHEDULER_INTERACTIVE,
+        WGP_SCHEDULER_VISIBLE,
+        WGP_SCHEDULER_PREFETCH,
+        WGP_SCHEDULER_BACKGROUND,
+        WGP_SCHEDULER_N_PRIORITIES
+} WgpSchedulerPriority;
+
+typedef struct _WgpOperation WgpOperation;
+
+
+GQuark
+wgp_scheduler_error_quark (void);
+
+void
+wgp_scheduler_init (guint limit, guint timeout, guint retry_count);
+
+/* The name of @callback is kept, to blame it for the stalls it causes */
+#define wgp_scheduler_browse(priority, source, container, keys, skip, count, \
+                             flags, callback, user_data)                \
+        _wgp_scheduler_browse (priority, source, container, keys, skip, count, \
+                               flags, callback, #callback, user_data)
+
+#define wgp_scheduler_search(priority, source, text, keys, skip, count, \
+                             flags, callback, user_data)                \
+        _wgp_scheduler_search (priority, source, text, keys, skip, count, \
+                               flags, callback, #callback, user_data)
+
+#define wgp_scheduler_metadata(priority, source, media, keys, flags,    \
+                               callback, user_data)                     \
+        _wgp_scheduler_metadata (priority, source, media, keys, flags,  \
+                                 callback, #callback, user_data)
+
+WgpOperation *
+_wgp_scheduler_browse (WgpSchedulerPriority priority,
+                       GrlMediaSource *source,
+                       GrlMedia *container,
+                       const GList *keys,
+                       guint skip,
+                       guint count,
+                       GrlMetadataResolutionFlags flags,
+                       GrlMediaSourceResultCb callback,
+                       const gchar *callback_name,
+                       gpointer user_data);
+
+WgpOperation *
+_wgp_scheduler_search (WgpSchedulerPriority priority,
+                       GrlMediaSource *source,
+                       const gchar *text,
+                       const GList *keys,
+                       guint skip,
+                       guint count,
+                       GrlMetadataResolutionFlags flags,
+                       GrlMediaSourceResultCb callback,
+                       const gchar *callback_name,
+                       gpointer user_data);
+
+WgpOperation *
+_wgp_scheduler_metadata (WgpSchedulerPriority priority,
+                         GrlMediaSource *source,
+                         GrlMedia *media,
+                         const GList *keys,
+                         GrlMetadataResolutionFlags flags,
+                         GrlMediaSourceMetadataCb callback,
+                         const gchar *callback_name,
+                         gpointer user_data);
+
+void
+wgp_scheduler_promote (WgpOperation *operation,
+                       WgpSchedulerPriority priority);
+
+void
+wgp_scheduler_demote (WgpOperation *operation,
+                      WgpSchedulerPriority priority);
+
+void
+wgp_scheduler_cancel (WgpOperation *operation);
+
+void
+wgp_scheduler_get_stats (WgpSchedulerPriority priority,
+                         guint *queued,
+                         guint *started,
+                         gdouble *average_wait,
+                         gdouble *max_wait);
+
+void
+wgp_scheduler_get_failures (guint *retries,
+                            guint *timeouts,
+                            guint *rejected);
+
+gboolean
+wgp_scheduler_is_degraded (GrlMediaSource *source);
+
+
+#endif
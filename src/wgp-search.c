@@ -0,0 +1,300 @@
+/*
+ * wgp-search.c: Search across sources
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wgp-search.h"
+#include "wgp-scheduler.h"
+
+/*
+ * A search is sent to every source supporting it at the same time, and the
+ * results are handed over as they arrive. Each source has its own deadline,
+ * after which its operation is cancelled. Results already seen in another
+ * source are dropped: the ones with the same URL or, as the URL is often
+ * slow to resolve, without URL and with the same case folded title and
+ * duration as a result of another source.
+ */
+
+struct _WgpSearch {
+        gchar *text;
+        GHashTable *seen;
+        GList *operations;
+        guint results;
+
+        WgpSearchResultFunc result_func;
+        WgpSearchDoneFunc done_func;
+        gpointer user_data;
+};
+
+typedef struct {
+        WgpSearch *search;
+        GrlMediaSource *source;
+        WgpOperation *scheduled;
+        guint deadline_id;
+} SearchOperation;
+
+
+static const GList *
+get_search_keys (void)
+{
+        static GList *keys = NULL;
+
+        if (keys == NULL) {
+                keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                                  GRL_METADATA_KEY_URL,
+                                                  GRL_METADATA_KEY_DURATION,
+                                                  NULL);
+        }
+
+        return keys;
+}
+
+static void
+operation_free (SearchOperation *operation)
+{
+        g_object_unref (operation->source);
+        g_slice_free (SearchOperation, operation);
+}
+
+/* The operation stops reporting to the search, it is freed on its last result */
+static void
+operation_detach (SearchOperation *operation)
+{
+        WgpSearch *search = operation->search;
+
+        if (operation->deadline_id) {
+                g_source_remove (operation->deadline_id);
+                operation->deadline_id = 0;
+        }
+
+        search->operations = g_list_remove (search->operations, operation);
+        operation->search = NULL;
+}
+
+/* Title and duration, for the results without URL */
+static gchar *
+get_title_key (GrlMedia *media)
+{
+        gchar *folded;
+        gchar *key;
+
+        if (grl_media_get_title (media) == NULL) {
+                return NULL;
+        }
+
+        folded = g_utf8_casefold (grl_media_get_title (media), -1);
+        key = g_strdup_printf ("title:%d:%s",
+                               grl_media_get_duration (media),
+                               folded);
+        g_free (folded);
+
+        return key;
+}
+
+/*
+ * Remembers @media, found in @source, returns whether it had been seen
+ * already. Titles only match results of other sources, a source can have
+ * several items with the same title.
+ */
+static gboolean
+check_seen (WgpSearch *search, GrlMediaSource *source, GrlMedia *media)
+{
+        const gchar *url;
+        gchar *url_key = NULL;
+        gchar *title_key;
+        gpointer title_source;
+        gboolean seen;
+
+        url = grl_media_get_url (media);
+        title_key = get_title_key (media);
+        if (url) {
+                url_key = g_strconcat ("url:", url, NULL);
+                seen = g_hash_table_contains (search->seen, url_key);
+        } else {
+                title_source = title_key ?
+                        g_hash_table_lookup (search->seen, title_key) : NULL;
+                seen = title_source && title_source != source;
+        }
+
+        if (url_key) {
+                g_hash_table_insert (search->seen, url_key, source);
+        }
+        if (title_key && !g_hash_table_contains (search->seen, title_key)) {
+                g_hash_table_insert (search->seen, title_key, source);
+        } else {
+                g_free (title_key);
+        }
+
+        return seen;
+}
+
+static void
+check_done (WgpSearch *search)
+{
+        if (search->operations == NULL) {
+                g_debug ("Search finished: '%s', %u results",
+                         search->text, search->results);
+                search->done_func (search, search->user_data);
+        }
+}
+
+static gboolean
+deadline_cb (gpointer user_data)
+{
+        SearchOperation *operation = user_data;
+        WgpSearch *search = operation->search;
+
+        g_debug ("Search deadline reached in '%s'",
+                 grl_metadata_source_get_name (
+                         GRL_METADATA_SOURCE (operation->source)));
+
+        operation->deadline_id = 0;
+        wgp_scheduler_cancel (operation->scheduled);
+        operation_detach (operation);
+        check_done (search);
+
+        return FALSE;
+}
+
+static void
+search_cb (GrlMediaSource *source,
+           guint search_id,
+           GrlMedia *media,
+           guint remaining,
+           gpointer user_data,
+           const GError *error)
+{
+        SearchOperation *operation = user_data;
+        WgpSearch *search = operation->search;
+
+        if (search == NULL) {
+                if (media) {
+                        g_object_unref (media);
+                }
+                if (remaining == 0) {
+                        operation_free (operation);
+                }
+                return;
+        }
+
+        if (error) {
+                g_warning ("Search operation failed in '%s'. Reason: %s",
+                           grl_metadata_source_get_name (GRL_METADATA_SOURCE (source)),
+                           error->message);
+        }
+
+        if (media) {
+                if (!check_seen (search, source, media)) {
+                        search->results++;
+                        search->result_func (search, media, search->user_data);
+                }
+                g_object_unref (media);
+        }
+
+        if (remaining == 0) {
+                operation_detach (operation);
+                operation_free (operation);
+                check_done (search);
+        }
+}
+
+
+WgpSearch *
+wgp_search_new (GrlPluginRegistry *registry,
+                const gchar *text,
+                guint deadline,
+                WgpSearchResultFunc result_func,
+                WgpSearchDoneFunc done_func,
+                gpointer user_data)
+{
+        WgpSearch *search;
+        SearchOperation *operation;
+        GList *sources;
+        GList *l;
+
+        search = g_slice_new0 (WgpSearch);
+        search->text = g_strdup (text);
+        search->seen = g_hash_table_new_full (g_str_hash,
+                                              g_str_equal,
+                                              g_free,
+                                              NULL);
+        search->result_func = result_func;
+        search->done_func = done_func;
+        search->user_data = user_data;
+
+        sources = grl_plugin_registry_get_sources_by_operations (registry,
+                                                                 GRL_OP_SEARCH,
+                                                                 FALSE);
+        for (l = sources; l; l = l->next) {
+                if (wgp_scheduler_is_degraded (l->data)) {
+                        g_debug ("Not searching in degraded source '%s'",
+                                 grl_metadata_source_get_name (GRL_METADATA_SOURCE (l->data)));
+                        continue;
+                }
+
+                operation = g_slice_new0 (SearchOperation);
+                operation->search = search;
+                operation->source = g_object_ref (l->data);
+                search->operations = g_list_prepend (search->operations,
+                                                     operation);
+
+                g_debug ("Searching '%s' in '%s'",
+                         text,
+                         grl_metadata_source_get_name (GRL_METADATA_SOURCE (l->data)));
+                operation->scheduled = wgp_scheduler_search (
+                        WGP_SCHEDULER_INTERACTIVE,
+                        operation->source,
+                        text,
+                        get_search_keys (),
+                        0, WGP_SEARCH_COUNT,
+                        GRL_RESOLVE_FAST_ONLY,
+                        search_cb,
+                        operation);
+                if (deadline > 0) {
+                        operation->deadline_id = g_timeout_add (deadline,
+                                                                deadline_cb,
+                                                                operation);
+                }
+        }
+        g_list_free (sources);
+
+        check_done (search);
+
+        return search;
+}
+
+void
+wgp_search_free (WgpSearch *search)
+{
+        SearchOperation *operation;
+
+        while (search->operations) {
+                operation = search->operations->data;
+                wgp_scheduler_cancel (operation->scheduled);
+                operation_detach (operation);
+        }
+
+        g_hash_table_destroy (search->seen);
+        g_free (search->text);
+        g_slice_free (WgpSearch, search);
+}
+
+guint
+wgp_search_get_results (WgpSearch *search)
+{
+        return search->results;
+}
@@ -0,0 +1,54 @@
+/*
+ * wgp-search.h: Search across sources
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_SEARCH_H__
+#define __WGP_SEARCH_H__
+
+#include <grilo.h>
+
+#define WGP_SEARCH_DEFAULT_DEADLINE 5000
+#define WGP_SEARCH_COUNT 50
+
+
+typedef struct _WgpSearch WgpSearch;
+
+typedef void (*WgpSearchResultFunc) (WgpSearch *search,
+                                     GrlMedia *media,
+                                     gpointer user_data);
+
+typedef void (*WgpSearchDoneFunc) (WgpSearch *search,
+                                   gpointer user_data);
+
+
+WgpSearch *
+wgp_search_new (GrlPluginRegistry *registry,
+                const gchar *text,
+                guint deadline,
+                WgpSearchResultFunc result_func,
+                WgpSearchDoneFunc done_func,
+                gpointer user_data);
+
+void
+wgp_search_free (WgpSearch *search);
+
+guint
+wgp_search_get_results (WgpSearch *search);
+
+
+#endif
@@ -0,0 +1,381 @@
+/*
+ * wgp-session.c: Snapshot of the last screen
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib/gstdio.h>
+#include "wgp-session.h"
+
+/*
+ * The source, boxes and rows shown are saved to a small key file, so the
+ * next start paints the same screen before any plugin is loaded. Media are
+ * kept column by column, with just the fields needed to draw and open them.
+ * The file is only written when its contents change.
+ */
+
+#define SESSION_VERSION 1
+
+typedef enum {
+        ITEM_MEDIA,
+        ITEM_BOX,
+        ITEM_VIDEO,
+        ITEM_AUDIO,
+        ITEM_IMAGE
+} ItemType;
+
+/* Checksum of the last snapshot written for every window */
+static GHashTable *last_checksums = NULL;
+
+
+/* The first window keeps the file used before there were several */
+static gchar *
+get_session_file (guint window)
+{
+        gchar *basename;
+        gchar *filename;
+
+        if (window == 0) {
+                basename = g_strdup ("session");
+        } else {
+                basename = g_strdup_printf ("session-%u", window);
+        }
+        filename = g_build_filename (g_get_user_cache_dir (), "wgp", basename, NULL);
+        g_free (basename);
+
+        return filename;
+}
+
+static const gchar *
+empty_if_null (const gchar *string)
+{
+        return string ? string : "";
+}
+
+static const gchar *
+null_if_empty (const gchar *string)
+{
+        return string && *string ? string : NULL;
+}
+
+/* Saves @items to @group, one list per field */
+static void
+set_media_list (GKeyFile *key_file, const gchar *group, GPtrArray *items)
+{
+        const gchar **ids;
+        const gchar **titles;
+        const gchar **urls;
+        const gchar **thumbnails;
+        gint *types;
+        gint *durations;
+        gint *childcounts;
+        GrlMedia *media;
+        guint i;
+
+        ids = g_new (const gchar *, items->len);
+        titles = g_new (const gchar *, items->len);
+        urls = g_new (const gchar *, items->len);
+        thumbnails = g_new (const gchar *, items->len);
+        types = g_new (gint, items->len);
+        durations = g_new (gint, items->len);
+        childcounts = g_new0 (gint, items->len);
+
+        for (i = 0; i < items->len; i++) {
+                media = g_ptr_array_index (items, i);
+
+                ids[i] = empty_if_null (grl_media_get_id (media));
+                titles[i] = empty_if_null (grl_media_get_title (media));
+                urls[i] = empty_if_null (grl_media_get_url (media));
+                thumbnails[i] = empty_if_null (grl_media_get_thumbnail (media));
+                durations[i] = grl_media_get_duration (media);
+
+                if (GRL_IS_MEDIA_BOX (media)) {
+                        types[i] = ITEM_BOX;
+                        childcounts[i] = grl_media_box_get_childcount (
+                                GRL_MEDIA_BOX (media));
+                } else if (GRL_IS_MEDIA_VIDEO (media)) {
+                        types[i] = ITEM_VIDEO;
+                } else if (GRL_IS_MEDIA_AUDIO (media)) {
+                        types[i] = ITEM_AUDIO;
+                } else if (GRL_IS_MEDIA_IMAGE (media)) {
+                        types[i] = ITEM_IMAGE;
+                } else {
+                        types[i] = ITEM_MEDIA;
+                }
+        }
+
+        g_key_file_set_string_list (key_file, group, "ids", ids, items->len);
+        g_key_file_set_string_list (key_file, group, "titles", titles, items->len);
+        g_key_file_set_string_list (key_file, group, "urls", urls, items->len);
+        g_key_file_set_string_list (key_file, group, "thumbnails",
+                                    thumbnails, items->len);
+        g_key_file_set_integer_list (key_file, group, "types", types, items->len);
+        g_key_file_set_integer_list (key_file, group, "durations",
+                                     durations, items->len);
+        g_key_file_set_integer_list (key_file, group, "childcounts",
+                                     childcounts, items->len);
+
+        g_free (ids);
+        g_free (titles);
+        g_free (urls);
+        g_free (thumbnails);
+        g_free (types);
+        g_free (durations);
+        g_free (childcounts);
+}
+
+/* Media saved in @group, or NULL if the lists are missing or do not match */
+static GPtrArray *
+get_media_list (GKeyFile *key_file, const gchar *group, const gchar *source_id)
+{
+        GPtrArray *items = NULL;
+        GrlMedia *media;
+        gchar **ids;
+        gchar **titles;
+        gchar **urls;
+        gchar **thumbnails;
+        gint *types;
+        gint *durations;
+        gint *childcounts;
+        gsize n_ids = 0;
+        gsize n_titles = 0;
+        gsize n_urls = 0;
+        gsize n_thumbnails = 0;
+        gsize n_types = 0;
+        gsize n_durations = 0;
+        gsize n_childcounts = 0;
+        guint i;
+
+        /* Empty lists are not written at all */
+        if (!g_key_file_has_key (key_file, group, "ids", NULL)) {
+                return g_ptr_array_new_with_free_func (g_object_unref);
+        }
+
+        ids = g_key_file_get_string_list (key_file, group, "ids", &n_ids, NULL);
+        titles = g_key_file_get_string_list (key_file, group, "titles",
+                                             &n_titles, NULL);
+        urls = g_key_file_get_string_list (key_file, group, "urls", &n_urls, NULL);
+        thumbnails = g_key_file_get_string_list (key_file, group, "thumbnails",
+                                                 &n_thumbnails, NULL);
+        types = g_key_file_get_integer_list (key_file, group, "types",
+                                             &n_types, NULL);
+        durations = g_key_file_get_integer_list (key_file, group, "durations",
+                                                 &n_durations, NULL);
+        childcounts = g_key_file_get_integer_list (key_file, group, "childcounts",
+                                                   &n_childcounts, NULL);
+
+        if (n_titles != n_ids || n_urls != n_ids || n_thumbnails != n_ids ||
+            n_types != n_ids || n_durations != n_ids || n_childcounts != n_ids) {
+                goto out;
+        }
+
+        items = g_ptr_array_new_with_free_func (g_object_unref);
+        for (i = 0; i < n_ids; i++) {
+                switch (types[i]) {
+                case ITEM_BOX:
+                        media = grl_media_box_new ();
+                        grl_media_box_set_childcount (GRL_MEDIA_BOX (media),
+                                                      childcounts[i]);
+                        break;
+                case ITEM_VIDEO:
+                        media = grl_media_video_new ();
+                        break;
+                case ITEM_AUDIO:
+                        media = grl_media_audio_new ();
+                        break;
+                case ITEM_IMAGE:
+                        media = grl_media_image_new ();
+                        break;
+                default:
+                        media = grl_media_new ();
+                        break;
+                }
+
+                grl_media_set_source (media, source_id);
+                grl_media_set_id (media, null_if_empty (ids[i]));
+                grl_media_set_title (media, null_if_empty (titles[i]));
+                grl_media_set_url (media, null_if_empty (urls[i]));
+                grl_media_set_thumbnail (media, null_if_empty (thumbnails[i]));
+                if (durations[i] > 0) {
+                        grl_media_set_duration (media, durations[i]);
+                }
+
+                g_ptr_array_add (items, media);
+        }
+
+ out:
+        g_strfreev (ids);
+        g_strfreev (titles);
+        g_strfreev (urls);
+        g_strfreev (thumbnails);
+        g_free (types);
+        g_free (durations);
+        g_free (childcounts);
+
+        return items;
+}
+
+
+WgpSession *
+wgp_session_new (const gchar *source_id,
+                 const gchar *source_name,
+                 glong scroll_top)
+{
+        WgpSession *session;
+
+        session = g_slice_new0 (WgpSession);
+        session->source_id = g_strdup (source_id);
+        session->source_name = g_strdup (source_name);
+        session->path = g_ptr_array_new_with_free_func (g_object_unref);
+        session->items = g_ptr_array_new_with_free_func (g_object_unref);
+        session->scroll_top = scroll_top;
+
+        return session;
+}
+
+void
+wgp_session_free (WgpSession *session)
+{
+        g_free (session->source_id);
+        g_free (session->source_name);
+        g_ptr_array_unref (session->path);
+        g_ptr_array_unref (session->items);
+        g_slice_free (WgpSession, session);
+}
+
+/* Returns the snapshot left by @window on the last run, or NULL */
+WgpSession *
+wgp_session_load (guint window)
+{
+        WgpSession *session = NULL;
+        GKeyFile *key_file;
+        GPtrArray *path = NULL;
+        GPtrArray *items = NULL;
+        gchar *filename;
+        gchar *source_id = NULL;
+        gchar *source_name = NULL;
+
+        key_file = g_key_file_new ();
+        filename = get_session_file (window);
+
+        if (!g_key_file_load_from_file (key_file, filename, G_KEY_FILE_NONE, NULL) ||
+            g_key_file_get_integer (key_file, "session", "version", NULL) !=
+            SESSION_VERSION) {
+                goto out;
+        }
+
+        source_id = g_key_file_get_string (key_file, "session", "source", NULL);
+        source_name = g_key_file_get_string (key_file, "session", "name", NULL);
+        if (source_id == NULL || source_name == NULL) {
+                goto out;
+        }
+
+        path = get_media_list (key_file, "path", source_id);
+        items = get_media_list (key_file, "rows", source_id);
+        if (path == NULL || items == NULL) {
+                goto out;
+        }
+
+        session = wgp_session_new (source_id,
+                                   source_name,
+                                   g_key_file_get_integer (key_file,
+                                                           "session",
+                                                           "scroll",
+                                                           NULL));
+        g_ptr_array_unref (session->path);
+        g_ptr_array_unref (session->items);
+        session->path = g_ptr_array_ref (path);
+        session->items = g_ptr_array_ref (items);
+
+ out:
+        if (path) {
+                g_ptr_array_unref (path);
+        }
+        if (items) {
+                g_ptr_array_unref (items);
+        }
+        g_free (source_id);
+        g_free (source_name);
+        g_free (filename);
+        g_key_file_free (key_file);
+
+        return session;
+}
+
+/* Saves @session of @window for the next run, NULL to start from the root */
+void
+wgp_session_save (guint window, WgpSession *session)
+{
+        GKeyFile *key_file;
+        gchar *filename;
+        gchar *dir;
+        gchar *data;
+        gchar *checksum;
+        gsize length;
+
+        if (last_checksums == NULL) {
+                last_checksums = g_hash_table_new_full (g_direct_hash,
+                                                        g_direct_equal,
+                                                        NULL,
+                                                        g_free);
+        }
+
+        filename = get_session_file (window);
+
+        if (session == NULL) {
+                g_hash_table_remove (last_checksums, GUINT_TO_POINTER (window));
+                g_unlink (filename);
+                g_free (filename);
+                return;
+        }
+
+        key_file = g_key_file_new ();
+        g_key_file_set_integer (key_file, "session", "version", SESSION_VERSION);
+        g_key_file_set_string (key_file, "session", "source", session->source_id);
+        g_key_file_set_string (key_file, "session", "name", session->source_name);
+        g_key_file_set_integer (key_file, "session", "scroll", session->scroll_top);
+        if (session->path->len > 0) {
+                set_media_list (key_file, "path", session->path);
+        }
+        if (session->items->len > 0) {
+                set_media_list (key_file, "rows", session->items);
+        }
+
+        data = g_key_file_to_data (key_file, &length, NULL);
+        checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, data, length);
+
+        if (g_strcmp0 (checksum,
+                       g_hash_table_lookup (last_checksums,
+                                            GUINT_TO_POINTER (window))) != 0) {
+                dir = g_path_get_dirname (filename);
+                g_mkdir_with_parents (dir, 0700);
+                g_free (dir);
+
+                if (g_file_set_contents (filename, data, length, NULL)) {
+                        g_hash_table_insert (last_checksums,
+                                             GUINT_TO_POINTER (window),
+                                             checksum);
+                        checksum = NULL;
+                } else {
+                        g_warning ("Failed to save session to %s", filename);
+                }
+        }
+
+        g_free (checksum);
+        g_free (data);
+        g_free (filename);
+        g_key_file_free (key_file);
+}
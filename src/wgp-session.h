@@ -0,0 +1,60 @@
+/*
+ * wgp-session.h: Snapshot of the last screen
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_SESSION_H__
+#define __WGP_SESSION_H__
+
+#include <grilo.h>
+
+/* Seconds between snapshots, besides the one on exit */
+#define WGP_SESSION_DEFAULT_INTERVAL 60
+
+/* Rows kept in a snapshot, at most */
+#define WGP_SESSION_MAX_ROWS 1000
+
+
+typedef struct {
+        gchar *source_id;
+        gchar *source_name;
+
+        /* Boxes opened from the root of the source */
+        GPtrArray *path;
+
+        /* First rows of the screen, in the order they were browsed */
+        GPtrArray *items;
+        glong scroll_top;
+} WgpSession;
+
+
+WgpSession *
+wgp_session_new (const gchar *source_id,
+                 const gchar *source_name,
+                 glong scroll_top);
+
+void
+wgp_session_free (WgpSession *session);
+
+WgpSession *
+wgp_session_load (guint window);
+
+void
+wgp_session_save (guint window, WgpSession *session);
+
+
+#endif
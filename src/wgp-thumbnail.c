@@ -0,0 +1,319 @@
+/*
+ * wgp-thumbnail.c: Thumbnails
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include "wgp-thumbnail.h"
+#include "wgp-util.h"
+#include "wgp-watchdog.h"
+
+/*
+ * Images are fetched, decoded and scaled down by a pool of worker threads.
+ * The results are stored as PNG files named after the SHA-1 of the original
+ * URI, so the main loop only has to point the row to them. Once the cache
+ * grows over its size the least recently used files are removed, the ones
+ * found already done are touched to keep them.
+ */
+
+typedef struct {
+        gchar *uri;
+        gchar *path;
+        gboolean ok;
+        GList *waiters;
+} Job;
+
+typedef struct {
+        WgpThumbnailFunc func;
+        gpointer user_data;
+} Waiter;
+
+static GThreadPool *pool = NULL;
+static gchar *cache_dir = NULL;
+
+/* Jobs in progress and thumbnails already done, only used from main loop */
+static GHashTable *jobs = NULL;
+static GHashTable *done = NULL;
+
+/* Shared with the workers */
+static GMutex size_mutex;
+static gsize cache_size = 0;
+static gsize max_size = WGP_THUMBNAIL_DEFAULT_CACHE_SIZE;
+static gboolean pruning = FALSE;
+
+/* Pushed to the pool to check the size of the cache */
+static Job prune_job;
+
+
+/* Forgets the thumbnails removed from disk, they are generated again */
+static gboolean
+pruned_cb (gpointer user_data)
+{
+        GPtrArray *removed = user_data;
+        GHashTableIter iter;
+        GHashTable *paths;
+        gpointer value;
+        gchar *path;
+        guint i;
+
+        wgp_watchdog_enter (G_STRFUNC);
+        paths = g_hash_table_new (g_str_hash, g_str_equal);
+        for (i = 0; i < removed->len; i++) {
+                g_hash_table_add (paths, g_ptr_array_index (removed, i));
+        }
+
+        g_hash_table_iter_init (&iter, done);
+        while (g_hash_table_iter_next (&iter, NULL, &value)) {
+                path = g_filename_from_uri (value, NULL, NULL);
+                if (path && g_hash_table_contains (paths, path)) {
+                        g_hash_table_iter_remove (&iter);
+                }
+                g_free (path);
+        }
+
+        g_hash_table_destroy (paths);
+        g_ptr_array_unref (removed);
+        wgp_watchdog_leave ();
+
+        return FALSE;
+}
+
+static void
+prune (void)
+{
+        GPtrArray *removed;
+        gsize size;
+
+        /* Leave some room, so it does not run after every new thumbnail */
+        removed = g_ptr_array_new_with_free_func (g_free);
+        size = wgp_util_prune_directory (cache_dir, max_size / 4 * 3, removed);
+
+        g_mutex_lock (&size_mutex);
+        cache_size = size;
+        pruning = FALSE;
+        g_mutex_unlock (&size_mutex);
+
+        if (removed->len > 0) {
+                g_idle_add (pruned_cb, removed);
+        } else {
+                g_ptr_array_unref (removed);
+        }
+}
+
+static gboolean
+generate (Job *job)
+{
+        GFile *file;
+        GdkPixbufLoader *loader;
+        GdkPixbuf *pixbuf;
+        GdkPixbuf *scaled = NULL;
+        GError *error = NULL;
+        gchar *contents = NULL;
+        gsize length;
+        gchar *tmp_path;
+        struct stat info;
+        gint width;
+        gint height;
+        gboolean prune_needed = FALSE;
+
+        file = g_file_new_for_uri (job->uri);
+        if (!g_file_load_contents (file, NULL, &contents, &length, NULL, &error)) {
+                g_debug ("Thumbnail failed: %s", error->message);
+                g_error_free (error);
+                g_object_unref (file);
+                return FALSE;
+        }
+        g_object_unref (file);
+
+        loader = gdk_pixbuf_loader_new ();
+        if (gdk_pixbuf_loader_write (loader, (guchar *) contents, length, NULL) &&
+            gdk_pixbuf_loader_close (loader, NULL)) {
+                pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+                width = gdk_pixbuf_get_width (pixbuf);
+                height = gdk_pixbuf_get_height (pixbuf);
+                if (width > height) {
+                        height = MAX (height * WGP_THUMBNAIL_SIZE / width, 1);
+                        width = WGP_THUMBNAIL_SIZE;
+                } else {
+                        width = MAX (width * WGP_THUMBNAIL_SIZE / height, 1);
+                        height = WGP_THUMBNAIL_SIZE;
+                }
+                scaled = gdk_pixbuf_scale_simple (pixbuf,
+                                                  width,
+                                                  height,
+                                                  GDK_INTERP_BILINEAR);
+        } else {
+                gdk_pixbuf_loader_close (loader, NULL);
+        }
+        g_object_unref (loader);
+        g_free (contents);
+
+        if (scaled == NULL) {
+                return FALSE;
+        }
+
+        /* Written aside and renamed, so readers never see half a file */
+        tmp_path = g_strconcat (job->path, ".tmp", NULL);
+        if (!gdk_pixbuf_save (scaled, tmp_path, "png", NULL, NULL) ||
+            g_rename (tmp_path, job->path) != 0) {
+                g_unlink (tmp_path);
+                g_free (tmp_path);
+                g_object_unref (scaled);
+                return FALSE;
+        }
+        g_free (tmp_path);
+        g_object_unref (scaled);
+
+        if (g_stat (job->path, &info) == 0) {
+                g_mutex_lock (&size_mutex);
+                cache_size += info.st_size;
+                if (cache_size > max_size && !pruning) {
+                        pruning = prune_needed = TRUE;
+                }
+                g_mutex_unlock (&size_mutex);
+        }
+
+        if (prune_needed) {
+                prune ();
+        }
+
+        return TRUE;
+}
+
+static gboolean
+job_done_cb (gpointer user_data)
+{
+        Job *job = user_data;
+        gchar *thumbnail_uri = NULL;
+        Waiter *waiter;
+        GList *l;
+
+        wgp_watchdog_enter (G_STRFUNC);
+        g_hash_table_steal (jobs, job->uri);
+
+        if (job->ok) {
+                thumbnail_uri = g_filename_to_uri (job->path, NULL, NULL);
+                g_hash_table_insert (done, g_strdup (job->uri), thumbnail_uri);
+        }
+
+        for (l = job->waiters; l; l = l->next) {
+                waiter = l->data;
+                waiter->func (job->uri, thumbnail_uri, waiter->user_data);
+                g_slice_free (Waiter, waiter);
+        }
+
+        g_list_free (job->waiters);
+        g_free (job->uri);
+        g_free (job->path);
+        g_slice_free (Job, job);
+        wgp_watchdog_leave ();
+
+        return FALSE;
+}
+
+static void
+worker_func (gpointer data, gpointer user_data)
+{
+        Job *job = data;
+
+        if (job == &prune_job) {
+                prune ();
+                return;
+        }
+
+        /* Touched, so the thumbnails in use are the last ones pruned */
+        if (g_utime (job->path, NULL) == 0) {
+                job->ok = TRUE;
+        } else {
+                job->ok = generate (job);
+        }
+        g_idle_add (job_done_cb, job);
+}
+
+
+void
+wgp_thumbnail_init (guint max_workers, gsize max_cache_size)
+{
+        max_size = max_cache_size;
+
+        cache_dir = g_build_filename (g_get_user_cache_dir (),
+                                      "wgp",
+                                      "thumbnails",
+                                      NULL);
+        g_mkdir_with_parents (cache_dir, 0700);
+
+        jobs = g_hash_table_new (g_str_hash, g_str_equal);
+        done = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+        pool = g_thread_pool_new (worker_func,
+                                  NULL,
+                                  MAX (max_workers, 1),
+                                  FALSE,
+                                  NULL);
+
+        /* Find out the current size of the cache */
+        pruning = TRUE;
+        g_thread_pool_push (pool, &prune_job, NULL);
+}
+
+const gchar *
+wgp_thumbnail_lookup (const gchar *uri)
+{
+        return g_hash_table_lookup (done, uri);
+}
+
+/*
+ * Calls @func from the main loop with the URI of the thumbnail of @uri, or
+ * NULL if it could not be generated.
+ */
+void
+wgp_thumbnail_request (const gchar *uri,
+                       WgpThumbnailFunc func,
+                       gpointer user_data)
+{
+        Job *job;
+        Waiter *waiter;
+        gchar *checksum;
+        gchar *name;
+
+        waiter = g_slice_new (Waiter);
+        waiter->func = func;
+        waiter->user_data = user_data;
+
+        job = g_hash_table_lookup (jobs, uri);
+        if (job) {
+                job->waiters = g_list_prepend (job->waiters, waiter);
+                return;
+        }
+
+        checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, uri, -1);
+        name = g_strconcat (checksum, ".png", NULL);
+
+        job = g_slice_new0 (Job);
+        job->uri = g_strdup (uri);
+        job->path = g_build_filename (cache_dir, name, NULL);
+        job->waiters = g_list_prepend (NULL, waiter);
+
+        g_free (checksum);
+        g_free (name);
+
+        g_hash_table_insert (jobs, job->uri, job);
+        g_thread_pool_push (pool, job, NULL);
+}
@@ -0,0 +1,49 @@
+/*
+ * wgp-thumbnail.h: Thumbnails
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_THUMBNAIL_H__
+#define __WGP_THUMBNAIL_H__
+
+#include <glib.h>
+
+/* Thumbnails are scaled down to fit in a square of this size */
+#define WGP_THUMBNAIL_SIZE 28
+
+#define WGP_THUMBNAIL_DEFAULT_WORKERS 2
+#define WGP_THUMBNAIL_DEFAULT_CACHE_SIZE (50 * 1024 * 1024)
+
+
+typedef void (*WgpThumbnailFunc) (const gchar *uri,
+                                  const gchar *thumbnail_uri,
+                                  gpointer user_data);
+
+
+void
+wgp_thumbnail_init (guint max_workers, gsize max_cache_size);
+
+const gchar *
+wgp_thumbnail_lookup (const gchar *uri);
+
+void
+wgp_thumbnail_request (const gchar *uri,
+                       WgpThumbnailFunc func,
+                       gpointer user_data);
+
+
+#endif
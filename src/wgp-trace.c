@@ -0,0 +1,190 @@
+/*
+ * wgp-trace.c: Trace events in Chrome trace event format
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "wgp-trace.h"
+
+/*
+ * Events are written as a JSON array that can be loaded in chrome://tracing
+ * or Perfetto. Everything is traced from the main loop, so there is a single
+ * thread.
+ */
+
+gboolean wgp_trace_enabled = FALSE;
+
+static FILE *trace_file = NULL;
+static gint64 trace_start = 0;
+static guint64 last_id = 0;
+static gint pid = 0;
+
+
+/*
+ * Returns @string escaped to go between quotes in a JSON string. It is
+ * interned, so it is only meant for the few strings seen in traces, like
+ * names and source ids.
+ */
+const gchar *
+wgp_trace_escape (const gchar *string)
+{
+        GString *escaped;
+        const gchar *interned;
+        const gchar *p;
+
+        if (string == NULL) {
+                return "";
+        }
+
+        escaped = g_string_new (NULL);
+        for (p = string; *p; p++) {
+                if (*p == '"' || *p == '\\') {
+                        g_string_append_c (escaped, '\\');
+                        g_string_append_c (escaped, *p);
+                } else if ((guchar) *p < 0x20) {
+                        g_string_append_printf (escaped, "\\u%04x", (guint) *p);
+                } else {
+                        g_string_append_c (escaped, *p);
+                }
+        }
+
+        interned = g_intern_string (escaped->str);
+        g_string_free (escaped, TRUE);
+
+        return interned;
+}
+
+
+/*
+ * Starts writing trace events to @filename. When @filename is NULL the
+ * WGP_TRACE environment variable is used, and if it is not set either
+ * tracing stays off.
+ */
+gboolean
+wgp_trace_init (const gchar *filename, GError **error)
+{
+        if (filename == NULL) {
+                filename = g_getenv (WGP_TRACE_ENV);
+        }
+
+        if (filename == NULL || *filename == '\0') {
+                return TRUE;
+        }
+
+        trace_file = fopen (filename, "w");
+        if (trace_file == NULL) {
+                g_set_error (error,
+                             G_FILE_ERROR,
+                             g_file_error_from_errno (errno),
+                             "Could not open trace file '%s': %s",
+                             filename,
+                             g_strerror (errno));
+                return FALSE;
+        }
+
+        fputs ("[\n", trace_file);
+        trace_start = g_get_monotonic_time ();
+        pid = getpid ();
+        wgp_trace_enabled = TRUE;
+
+        g_message ("Tracing to %s", filename);
+
+        return TRUE;
+}
+
+void
+wgp_trace_shutdown (void)
+{
+        if (!wgp_trace_enabled) {
+                return;
+        }
+
+        wgp_trace_enabled = FALSE;
+
+        /* Metadata event, it also avoids the trailing comma */
+        fprintf (trace_file,
+                 "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+                 "\"args\": {\"name\": \"web-grilo-player\"}}\n]\n",
+                 pid);
+        fclose (trace_file);
+        trace_file = NULL;
+}
+
+/* Current time for wgp_trace_complete(), 0 when tracing is off */
+gint64
+wgp_trace_now (void)
+{
+        if (G_LIKELY (!wgp_trace_enabled)) {
+                return 0;
+        }
+
+        return g_get_monotonic_time ();
+}
+
+guint64
+wgp_trace_new_id (void)
+{
+        return ++last_id;
+}
+
+void
+_wgp_trace_event (gchar phase,
+                  const gchar *category,
+                  const gchar *name,
+                  guint64 id,
+                  gint64 start,
+                  const gchar *args_format,
+                  ...)
+{
+        va_list args;
+        gint64 now;
+
+        now = g_get_monotonic_time ();
+
+        fprintf (trace_file,
+                 "{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"%c\", \"pid\": %d, \"tid\": 1",
+                 wgp_trace_escape (name),
+                 category,
+                 phase,
+                 pid);
+
+        if (phase == 'X') {
+                fprintf (trace_file,
+                         ", \"ts\": %" G_GINT64_FORMAT ", \"dur\": %" G_GINT64_FORMAT,
+                         start - trace_start,
+                         now - start);
+        } else {
+                fprintf (trace_file,
+                         ", \"ts\": %" G_GINT64_FORMAT
+                         ", \"id\": \"0x%" G_GINT64_MODIFIER "x\"",
+                         now - trace_start,
+                         id);
+        }
+
+        if (args_format) {
+                fputs (", \"args\": {", trace_file);
+                va_start (args, args_format);
+                vfprintf (trace_file, args_format, args);
+                va_end (args);
+                fputc ('}', trace_file);
+        }
+
+        fputs ("},\n", trace_file);
+}
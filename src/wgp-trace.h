@@ -0,0 +1,90 @@
+/*
+ * wgp-trace.h: Trace events in Chrome trace event format
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_TRACE_H__
+#define __WGP_TRACE_H__
+
+#include <glib.h>
+
+/* Environment variable with the trace file, same as --trace */
+#define WGP_TRACE_ENV "WGP_TRACE"
+
+
+extern gboolean wgp_trace_enabled;
+
+/*
+ * The macros below do nothing but checking a flag when tracing is off, their
+ * arguments are not even evaluated. @args is a printf format for the members
+ * of the "args" object, like "\"count\": %u", or NULL. Strings go through
+ * wgp_trace_escape().
+ */
+
+/* Duration event from @start (got with wgp_trace_now()) until now */
+#define wgp_trace_complete(category, name, start, ...)                  \
+        G_STMT_START {                                                  \
+                if (G_UNLIKELY (wgp_trace_enabled))                     \
+                        _wgp_trace_event ('X', category, name, 0, start, __VA_ARGS__); \
+        } G_STMT_END
+
+/* Asynchronous span, matched by @id, over several main loop iterations */
+#define wgp_trace_begin(category, name, id, ...)                        \
+        G_STMT_START {                                                  \
+                if (G_UNLIKELY (wgp_trace_enabled))                     \
+                        _wgp_trace_event ('b', category, name, id, 0, __VA_ARGS__); \
+        } G_STMT_END
+
+#define wgp_trace_mark(category, name, id, ...)                         \
+        G_STMT_START {                                                  \
+                if (G_UNLIKELY (wgp_trace_enabled))                     \
+                        _wgp_trace_event ('n', category, name, id, 0, __VA_ARGS__); \
+        } G_STMT_END
+
+#define wgp_trace_end(category, name, id, ...)                          \
+        G_STMT_START {                                                  \
+                if (G_UNLIKELY (wgp_trace_enabled))                     \
+                        _wgp_trace_event ('e', category, name, id, 0, __VA_ARGS__); \
+        } G_STMT_END
+
+
+gboolean
+wgp_trace_init (const gchar *filename, GError **error);
+
+void
+wgp_trace_shutdown (void);
+
+gint64
+wgp_trace_now (void);
+
+guint64
+wgp_trace_new_id (void);
+
+const gchar *
+wgp_trace_escape (const gchar *string);
+
+void
+_wgp_trace_event (gchar phase,
+                  const gchar *category,
+                  const gchar *name,
+                  guint64 id,
+                  gint64 start,
+                  const gchar *args_format,
+                  ...) G_GNUC_PRINTF (6, 7);
+
+
+#endif
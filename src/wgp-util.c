@@ -17,8 +17,26 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <sys/stat.h>
+#include <glib/gstdio.h>
 #include "wgp-util.h"
 
+typedef struct {
+        gchar *path;
+        time_t mtime;
+        goffset size;
+} DirectoryFile;
+
+static gint
+compare_mtime (gconstpointer a, gconstpointer b)
+{
+        const DirectoryFile *file_a = *(DirectoryFile **) a;
+        const DirectoryFile *file_b = *(DirectoryFile **) b;
+
+        return file_a->mtime < file_b->mtime ? -1 : file_a->mtime > file_b->mtime;
+}
+
+
 void
 wgp_util_remove_all_children (WebKitDOMNode *parent)
 {
@@ -29,3 +47,96 @@ wgp_util_remove_all_children (WebKitDOMNode *parent)
                 webkit_dom_node_remove_child (parent, node, NULL);
         }
 }
+
+/*
+ * Looks for the "data-index" attribute in the target of @event or in its
+ * ancestors up to @container, for handlers delegated in the container.
+ */
+gboolean
+wgp_util_get_event_index (WebKitDOMEvent *event,
+                          WebKitDOMNode *container,
+                          guint *index)
+{
+        WebKitDOMNode *node;
+        gchar *value;
+
+        node = WEBKIT_DOM_NODE (webkit_dom_event_get_target (event));
+
+        while (node != NULL && node != container) {
+                if (WEBKIT_DOM_IS_ELEMENT (node) &&
+                    webkit_dom_element_has_attribute (WEBKIT_DOM_ELEMENT (node),
+                                                      "data-index")) {
+                        value = webkit_dom_element_get_attribute (
+                                WEBKIT_DOM_ELEMENT (node),
+                                "data-index");
+                        *index = g_ascii_strtoull (value, NULL, 10);
+                        g_free (value);
+
+                        return TRUE;
+                }
+
+                node = webkit_dom_node_get_parent_node (node);
+        }
+
+        return FALSE;
+}
+
+/*
+ * Removes the oldest files of @path until their total size is at most
+ * @max_size, adding their paths to @removed unless it is NULL. Returns the
+ * size of the files left.
+ */
+gsize
+wgp_util_prune_directory (const gchar *path,
+                          gsize max_size,
+                          GPtrArray *removed)
+{
+        GDir *dir;
+        const gchar *name;
+        GPtrArray *files;
+        DirectoryFile *file;
+        struct stat info;
+        gsize size = 0;
+        guint i;
+
+        dir = g_dir_open (path, 0, NULL);
+        if (dir == NULL) {
+                return 0;
+        }
+
+        files = g_ptr_array_new ();
+        while ((name = g_dir_read_name (dir)) != NULL) {
+                file = g_slice_new (DirectoryFile);
+                file->path = g_build_filename (path, name, NULL);
+                if (g_stat (file->path, &info) == 0) {
+                        file->mtime = info.st_mtime;
+                        file->size = info.st_size;
+                        size += info.st_size;
+                        g_ptr_array_add (files, file);
+                } else {
+                        g_free (file->path);
+                        g_slice_free (DirectoryFile, file);
+                }
+        }
+        g_dir_close (dir);
+
+        g_ptr_array_sort (files, compare_mtime);
+        for (i = 0; i < files->len && size > max_size; i++) {
+                file = g_ptr_array_index (files, i);
+                if (g_unlink (file->path) == 0) {
+                        size -= file->size;
+                        if (removed) {
+                                g_ptr_array_add (removed, g_strdup (file->path));
+                        }
+                }
+        }
+
+        for (i = 0; i < files->len; i++) {
+                file = g_ptr_array_index (files, i);
+                g_free (file->path);
+                g_slice_free (DirectoryFile, file);
+        }
+        g_ptr_array_free (files, TRUE);
+
+        return size;
+}
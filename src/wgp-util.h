@@ -26,5 +26,15 @@
 void
 wgp_util_remove_all_children (WebKitDOMNode *parent);
 
+gboolean
+wgp_util_get_event_index (WebKitDOMEvent *event,
+                          WebKitDOMNode *container,
+                          guint *index);
+
+gsize
+wgp_util_prune_directory (const gchar *path,
+                          gsize max_size,
+                          GPtrArray *removed);
+
 
 #endif
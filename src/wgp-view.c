@@ -0,0 +1,136 @@
+/*
+ * wgp-view.c: Browse views
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wgp-view.h"
+
+#define ARENA_CHUNK_SIZE 4096
+
+/*
+ * A view is one browse of one container. Everything it shows (objects and
+ * strings) belongs to it and is released at once when the view is replaced.
+ */
+struct _WgpView {
+        GStringChunk *strings;
+        gsize bytes;
+        GPtrArray *objects;
+};
+
+static guint live_objects = 0;
+static gsize arena_bytes = 0;
+
+static GQuark tracked_quark = 0;
+
+
+static void
+object_finalized_cb (gpointer data, GObject *where_the_object_was)
+{
+        live_objects--;
+}
+
+/* Counts the objects alive, no matter if they are held by a view or not */
+static void
+track_object (GObject *object)
+{
+        if (tracked_quark == 0) {
+                tracked_quark = g_quark_from_static_string ("wgp-view-tracked");
+        }
+
+        if (g_object_get_qdata (object, tracked_quark) == NULL) {
+                g_object_set_qdata (object, tracked_quark, GUINT_TO_POINTER (1));
+                g_object_weak_ref (object, object_finalized_cb, NULL);
+                live_objects++;
+        }
+}
+
+
+WgpView *
+wgp_view_new (void)
+{
+        WgpView *view;
+
+        view = g_slice_new0 (WgpView);
+        view->strings = g_string_chunk_new (ARENA_CHUNK_SIZE);
+        view->objects = g_ptr_array_new_with_free_func (g_object_unref);
+
+        return view;
+}
+
+void
+wgp_view_free (WgpView *view)
+{
+        arena_bytes -= view->bytes;
+
+        g_string_chunk_free (view->strings);
+        g_ptr_array_free (view->objects, TRUE);
+        g_slice_free (WgpView, view);
+}
+
+gpointer
+wgp_view_add_object (WgpView *view, gpointer object)
+{
+        track_object (G_OBJECT (object));
+        g_ptr_array_add (view->objects, g_object_ref (object));
+
+        return object;
+}
+
+const gchar *
+wgp_view_strdup (WgpView *view, const gchar *string)
+{
+        gsize length;
+
+        if (string == NULL) {
+                return NULL;
+        }
+
+        length = strlen (string) + 1;
+        view->bytes += length;
+        arena_bytes += length;
+
+        return g_string_chunk_insert_len (view->strings, string, length - 1);
+}
+
+const gchar *
+wgp_view_strdup_printf (WgpView *view, const gchar *format, ...)
+{
+        const gchar *string;
+        gchar *buffer;
+        va_list args;
+
+        va_start (args, format);
+        buffer = g_strdup_vprintf (format, args);
+        va_end (args);
+
+        string = wgp_view_strdup (view, buffer);
+        g_free (buffer);
+
+        return string;
+}
+
+guint
+wgp_view_get_live_objects (void)
+{
+        return live_objects;
+}
+
+gsize
+wgp_view_get_arena_bytes (void)
+{
+        return arena_bytes;
+}
@@ -0,0 +1,53 @@
+/*
+ * wgp-view.h: Browse views
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_VIEW_H__
+#define __WGP_VIEW_H__
+
+#include <glib-object.h>
+
+
+typedef struct _WgpView WgpView;
+
+
+WgpView *
+wgp_view_new (void);
+
+void
+wgp_view_free (WgpView *view);
+
+gpointer
+wgp_view_add_object (WgpView *view, gpointer object);
+
+const gchar *
+wgp_view_strdup (WgpView *view, const gchar *string);
+
+const gchar *
+wgp_view_strdup_printf (WgpView *view,
+                        const gchar *format,
+                        ...) G_GNUC_PRINTF (2, 3);
+
+guint
+wgp_view_get_live_objects (void);
+
+gsize
+wgp_view_get_arena_bytes (void);
+
+
+#endif
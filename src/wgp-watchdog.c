@@ -0,0 +1,263 @@
+/*
+ * wgp-watchdog.c: Main loop stall watchdog
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <signal.h>
+
+#include "wgp-watchdog.h"
+
+/*
+ * A timeout probes the main loop periodically and the delay of every probe is
+ * added to a histogram. The callbacks wrapped with wgp_watchdog_enter() and
+ * wgp_watchdog_leave() taking longer than the threshold are recorded as long
+ * tasks under their names; a late probe without any long task since the
+ * previous one is blamed on the unwrapped ones (WebKit layout and painting,
+ * signal handlers...). Everything is dumped on SIGUSR1 and at exit.
+ */
+
+/* Under 1 ms, under 2 ms... and 1 s or more in the last one */
+#define N_BUCKETS 12
+
+/* Deeper callbacks are not timed */
+#define MAX_DEPTH 16
+
+#define UNATTRIBUTED "(unattributed)"
+
+typedef struct {
+        const gchar *name;
+        gint64 start;
+} Frame;
+
+typedef struct {
+        const gchar *name;
+        guint count;
+        gint64 total;
+        gint64 max;
+} Offender;
+
+gboolean wgp_watchdog_enabled = FALSE;
+
+static gint64 threshold = 0;
+
+static Frame stack[MAX_DEPTH];
+static guint depth = 0;
+
+static gint64 next_probe = 0;
+static gboolean attributed = FALSE;
+static volatile sig_atomic_t dump_requested = 0;
+
+static guint probes = 0;
+static guint late_probes = 0;
+static guint probe_histogram[N_BUCKETS];
+
+static guint tasks = 0;
+static guint long_tasks = 0;
+static guint task_histogram[N_BUCKETS];
+
+static GHashTable *offenders = NULL;
+
+
+static void
+add_to_histogram (guint *histogram, gint64 duration)
+{
+        gint64 limit = 1000;
+        guint bucket = 0;
+
+        while (bucket < N_BUCKETS - 1 && duration >= limit) {
+                limit *= 2;
+                bucket++;
+        }
+        histogram[bucket]++;
+}
+
+static void
+record_offender (const gchar *name, gint64 duration)
+{
+        Offender *offender;
+
+        offender = g_hash_table_lookup (offenders, name);
+        if (offender == NULL) {
+                offender = g_slice_new0 (Offender);
+                offender->name = name;
+                g_hash_table_insert (offenders, (gpointer) name, offender);
+        }
+
+        offender->count++;
+        offender->total += duration;
+        offender->max = MAX (offender->max, duration);
+}
+
+static gboolean
+probe_cb (gpointer user_data)
+{
+        gint64 now;
+        gint64 delay;
+
+        now = g_get_monotonic_time ();
+        delay = MAX (now - next_probe, 0);
+        next_probe = now + WGP_WATCHDOG_PROBE_INTERVAL * 1000;
+
+        probes++;
+        add_to_histogram (probe_histogram, delay);
+        if (delay >= threshold) {
+                late_probes++;
+                if (!attributed) {
+                        record_offender (UNATTRIBUTED, delay);
+                }
+        }
+        attributed = FALSE;
+
+        if (dump_requested) {
+                dump_requested = 0;
+                wgp_watchdog_dump ();
+        }
+
+        return TRUE;
+}
+
+static void
+sigusr1_handler (gint signum)
+{
+        dump_requested = 1;
+}
+
+static gint
+compare_offenders (gconstpointer a, gconstpointer b)
+{
+        const Offender *offender_a = a;
+        const Offender *offender_b = b;
+
+        return offender_a->total < offender_b->total ? 1 :
+                offender_a->total > offender_b->total ? -1 : 0;
+}
+
+static gchar *
+format_histogram (const guint *histogram)
+{
+        GString *text;
+        guint bucket;
+
+        text = g_string_new (NULL);
+        for (bucket = 0; bucket < N_BUCKETS - 1; bucket++) {
+                g_string_append_printf (text, "<%u ms: %u, ",
+                                        1 << bucket, histogram[bucket]);
+        }
+        g_string_append_printf (text, ">=%u ms: %u",
+                                1 << (N_BUCKETS - 1), histogram[N_BUCKETS - 1]);
+
+        return g_string_free (text, FALSE);
+}
+
+
+/*
+ * Starts probing the main loop, the delays and callbacks of @threshold_ms
+ * milliseconds or more are reported as stalls.
+ */
+void
+wgp_watchdog_init (guint threshold_ms)
+{
+        threshold = (gint64) threshold_ms * 1000;
+        offenders = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, NULL);
+
+        next_probe = g_get_monotonic_time () + WGP_WATCHDOG_PROBE_INTERVAL * 1000;
+        g_timeout_add (WGP_WATCHDOG_PROBE_INTERVAL, probe_cb, NULL);
+        signal (SIGUSR1, sigusr1_handler);
+
+        wgp_watchdog_enabled = TRUE;
+
+        g_message ("Watchdog reporting stalls of %u ms, dump with SIGUSR1",
+                   threshold_ms);
+}
+
+void
+wgp_watchdog_dump (void)
+{
+        GList *list;
+        GList *l;
+        Offender *offender;
+        gchar *histogram;
+        guint i;
+
+        if (!wgp_watchdog_enabled) {
+                return;
+        }
+
+        g_message ("Watchdog: %u probes, %u late; %u tasks, %u long",
+                   probes, late_probes, tasks, long_tasks);
+
+        histogram = format_histogram (probe_histogram);
+        g_message ("Main loop delay: %s", histogram);
+        g_free (histogram);
+
+        histogram = format_histogram (task_histogram);
+        g_message ("Task duration: %s", histogram);
+        g_free (histogram);
+
+        list = g_list_sort (g_hash_table_get_values (offenders), compare_offenders);
+        for (l = list, i = 0; l && i < WGP_WATCHDOG_MAX_OFFENDERS; l = l->next, i++) {
+                offender = l->data;
+                g_message ("Long task %s: %u times, %.1f ms in total, %.1f ms max",
+                           offender->name,
+                           offender->count,
+                           offender->total / 1000.0,
+                           offender->max / 1000.0);
+        }
+        g_list_free (list);
+}
+
+void
+_wgp_watchdog_enter (const gchar *name)
+{
+        if (depth < MAX_DEPTH) {
+                stack[depth].name = name;
+                stack[depth].start = g_get_monotonic_time ();
+        }
+        depth++;
+}
+
+void
+_wgp_watchdog_leave (void)
+{
+        Frame *frame;
+        gint64 duration;
+
+        g_return_if_fail (depth > 0);
+
+        depth--;
+        if (depth >= MAX_DEPTH) {
+                return;
+        }
+
+        frame = &stack[depth];
+        duration = g_get_monotonic_time () - frame->start;
+
+        if (depth == 0) {
+                tasks++;
+                add_to_histogram (task_histogram, duration);
+        }
+
+        if (duration >= threshold) {
+                record_offender (frame->name, duration);
+                attributed = TRUE;
+                if (depth == 0) {
+                        long_tasks++;
+                        g_debug ("Long task %s: %.1f ms",
+                                 frame->name, duration / 1000.0);
+                }
+        }
+}
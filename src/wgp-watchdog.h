@@ -0,0 +1,66 @@
+/*
+ * wgp-watchdog.h: Main loop stall watchdog
+ *
+ * Copyright (C) 2010 Manuel Rego Casasnovas <mrego@igalia.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WGP_WATCHDOG_H__
+#define __WGP_WATCHDOG_H__
+
+#include <glib.h>
+
+/* Milliseconds between probes of the main loop */
+#define WGP_WATCHDOG_PROBE_INTERVAL 100
+
+/* Offenders listed on every dump */
+#define WGP_WATCHDOG_MAX_OFFENDERS 10
+
+
+extern gboolean wgp_watchdog_enabled;
+
+/*
+ * Callbacks dispatched by the main loop are wrapped in these, @name being a
+ * static string like G_STRFUNC. They only check a flag when the watchdog is
+ * off. Nested ones are counted on their own too, so the offender can be told
+ * apart from the callback that dispatched it.
+ */
+#define wgp_watchdog_enter(name)                                        \
+        G_STMT_START {                                                  \
+                if (G_UNLIKELY (wgp_watchdog_enabled))                  \
+                        _wgp_watchdog_enter (name);                     \
+        } G_STMT_END
+
+#define wgp_watchdog_leave()                                            \
+        G_STMT_START {                                                  \
+                if (G_UNLIKELY (wgp_watchdog_enabled))                  \
+                        _wgp_watchdog_leave ();                         \
+        } G_STMT_END
+
+
+void
+wgp_watchdog_init (guint threshold);
+
+void
+wgp_watchdog_dump (void);
+
+void
+_wgp_watchdog_enter (const gchar *name);
+
+void
+_wgp_watchdog_leave (void);
+
+
+#endif